@@ -1,32 +1,39 @@
 #version 450
 
-// From uniform buffer
+// MeshPushConstants, like triangle.vert
 layout(push_constant) uniform constants {
   mat4 model;
   mat4 view;
   mat4 proj;
+  uint textureIndex;
 }
 pc;
 
-// From vertex buffer (and clip stuff)
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+struct Particle {
+  vec4 position;
+  vec4 velocity;
+};
+
+// Read straight out of the simulation's storage buffer, one point per particle.
+layout(std430, set = 0, binding = 0) readonly buffer Particles { Particle particles[]; };
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
   float point_size_scale = 2.0f;
+  Particle particle = particles[gl_VertexIndex];
 
-  vec4 view_pos = pc.view * pc.model * vec4(inPosition, 1.0f);
+  vec4 view_pos = pc.view * pc.model * vec4(particle.position.xyz, 1.0f);
   float distance = length(view_pos.xyz);
   gl_Position = pc.proj * view_pos;
 
   // Inverse distance scaling with min/max bounds
   float size = point_size_scale / max(distance, 0.001);
-  gl_PointSize = size;
+  gl_PointSize = max(size, 1.0f);
 
-  fragColor = vec3(1.0f);  // inColor;
-  fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+  // Faster particles are hotter.
+  float speed = length(particle.velocity.xyz);
+  fragColor = mix(vec3(0.4f, 0.6f, 1.0f), vec3(1.0f, 0.8f, 0.6f), clamp(speed * 0.5f, 0.0f, 1.0f));
+  fragTexCoord = vec2(0.0f);
+}
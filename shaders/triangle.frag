@@ -1,9 +1,12 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 0) uniform sampler2D texSampler;
+// The bindless texture table (see BindlessTextures)
+layout(set = 0, binding = 0) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTexture;
 
 layout(location = 0) out vec4 outColor;
 
@@ -20,5 +23,5 @@ float linearizeDepth(float depth, float near, float far) {
 void main() {
     float depth = gl_FragCoord.z;
     // outColor = vec4(fragColor, 1.0f);
-    outColor = texture(texSampler, fragTexCoord);
+    outColor = texture(textures[nonuniformEXT(fragTexture)], fragTexCoord);
 }
\ No newline at end of file
@@ -5,6 +5,7 @@ layout(push_constant) uniform constants {
   mat4 model;
   mat4 view;
   mat4 proj;
+  uint textureIndex;
 }
 pc;
 
@@ -16,6 +17,7 @@ layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTexture;
 
 // vertex: the vertex to be snapped (needs to be in projection-space)
 // resolution: the lower resolution, e.g. if my screen resolution is 1280x720, I might choose
@@ -33,4 +35,5 @@ void main() {
   gl_Position = pc.proj * pc.view * pc.model * vec4(inPosition, 1.0f);
   fragColor = inColor;
   fragTexCoord = inTexCoord;
+  fragTexture = pc.textureIndex;
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+// ren-trace: converts a binary trace (*.rtrace) written by ren's Instrumentor
+// into the Chrome trace event JSON format, which chrome://tracing, Perfetto
+// and speedscope can all open.
+//
+// usage: ren-trace <input.rtrace> [output.json]
+
+#include <ren/core/TraceFormat.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Names come from __PRETTY_FUNCTION__ and friends, so escape anything that
+// would break the JSON.
+static void writeEscaped(FILE *out, const std::string &str) {
+  for (char c : str) {
+    switch (c) {
+      case '"': fputs("\\\"", out); break;
+      case '\\': fputs("\\\\", out); break;
+      case '\n': fputs("\\n", out); break;
+      case '\t': fputs("\\t", out); break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          fprintf(out, "\\u%04x", c);
+        } else {
+          fputc(c, out);
+        }
+    }
+  }
+}
+
+// The JSON format wants microseconds, we store nanoseconds.
+static void writeMicros(FILE *out, uint64_t ns) {
+  fprintf(out, "%" PRIu64 ".%03u", ns / 1000, static_cast<unsigned>(ns % 1000));
+}
+
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <input.rtrace> [output.json]\n", argv[0]);
+    return 1;
+  }
+
+  std::string inputPath = argv[1];
+  std::string outputPath;
+  if (argc == 3) {
+    outputPath = argv[2];
+  } else {
+    auto dot = inputPath.rfind('.');
+    outputPath = (dot == std::string::npos ? inputPath : inputPath.substr(0, dot)) + ".json";
+  }
+
+  std::ifstream file(inputPath, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    fprintf(stderr, "Failed to open trace file: %s\n", inputPath.c_str());
+    return 1;
+  }
+  std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(reinterpret_cast<char *>(data.data()), data.size());
+  file.close();
+
+  ren::trace::Decoder decoder(data.data(), data.size());
+  if (!decoder.readHeader()) {
+    fprintf(stderr, "%s is not a ren trace (or is from an incompatible version)\n",
+            inputPath.c_str());
+    return 1;
+  }
+
+  FILE *out = fopen(outputPath.c_str(), "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "Failed to open output file: %s\n", outputPath.c_str());
+    return 1;
+  }
+
+  fputs("{\"otherData\":{},\"traceEvents\":[", out);
+
+  uint64_t events = 0;
+  ren::trace::Event event;
+  while (decoder.next(event)) {
+    if (events++ > 0) fputc(',', out);
+
+    if (event.tag == ren::trace::TAG_TRACK) {
+      fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,", event.thread);
+      fputs("\"args\":{\"name\":\"", out);
+      writeEscaped(out, decoder.getName(event.name));
+      fputs("\"}}", out);
+      continue;
+    }
+
+    fputs("{\"name\":\"", out);
+    writeEscaped(out, decoder.getName(event.name));
+    fprintf(out, "\",\"pid\":0,\"tid\":%u,\"ts\":", event.thread);
+    writeMicros(out, event.timestamp);
+
+    switch (event.tag) {
+      case ren::trace::TAG_COMPLETE:
+        fputs(",\"cat\":\"function\",\"ph\":\"X\",\"dur\":", out);
+        writeMicros(out, event.duration);
+        break;
+      case ren::trace::TAG_INSTANT: fputs(",\"ph\":\"i\",\"s\":\"t\"", out); break;
+      case ren::trace::TAG_COUNTER:
+        fprintf(out, ",\"ph\":\"C\",\"args\":{\"value\":%.3f}", event.value);
+        break;
+      default: break;
+    }
+    fputc('}', out);
+  }
+
+  fputs("]}\n", out);
+  fclose(out);
+
+  if (decoder.getOffset() < data.size()) {
+    fprintf(stderr, "warning: trace is truncated, stopped after %zu of %zu bytes\n",
+            decoder.getOffset(), data.size());
+  }
+  printf("Wrote %" PRIu64 " events to %s (%zu bytes of trace)\n", events, outputPath.c_str(),
+         data.size());
+  return 0;
+}
@@ -3,6 +3,8 @@
 #include <ren/Camera.h>
 #include <SDL2/SDL.h>
 #include <ren/core/Instrumentation.h>
+#include <fstream>
+#include <sstream>
 
 void ren::Camera::update(float dt) {
   REN_PROFILE_FUNCTION();
@@ -82,4 +84,84 @@ void ren::Camera::update(float dt) {
   position += velocity * dt;
   // damp velocity according to dt
   velocity *= (1.0f - dt * 5.0f);  // Damping factor, adjust as needed
-}
\ No newline at end of file
+}
+
+
+void ren::Camera::lookAt(glm::vec3 target) {
+  glm::vec3 dir = glm::normalize(target - position);
+  angles.x = asinf(dir.y);            // pitch
+  angles.y = atan2f(dir.x, -dir.z);  // yaw
+  angles.z = 0.0f;
+}
+
+
+void ren::CameraPath::addKeyframe(float time, glm::vec3 position, glm::vec3 angles) {
+  if (!keyframes.empty()) {
+    // Keep yaw continuous, so interpolating across the +-pi seam doesn't spin the camera.
+    float previous = keyframes.back().angles.y;
+    while (angles.y - previous > M_PI) angles.y -= 2.0f * M_PI;
+    while (angles.y - previous < -M_PI) angles.y += 2.0f * M_PI;
+  }
+  keyframes.push_back({time, position, angles});
+}
+
+
+ren::CameraPath ren::CameraPath::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file) throw std::runtime_error("failed to open camera path " + filename);
+
+  CameraPath path;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream in(line);
+    float time;
+    glm::vec3 position, angles(0.0f);
+    if (!(in >> time >> position.x >> position.y >> position.z >> angles.x >> angles.y)) {
+      throw std::runtime_error("bad keyframe in camera path " + filename + ": " + line);
+    }
+    path.addKeyframe(time, position, angles);
+  }
+  return path;
+}
+
+
+ren::CameraPath ren::CameraPath::orbit(glm::vec3 center, float radius, float height,
+                                       float duration, int steps) {
+  CameraPath path;
+  for (int i = 0; i <= steps; i++) {
+    float t = (float)i / steps;
+    float theta = 2.0f * M_PI * t;
+
+    Camera camera;
+    camera.position = center + glm::vec3(radius * cosf(theta), height, radius * sinf(theta));
+    camera.lookAt(center);
+    path.addKeyframe(t * duration, camera.position, camera.angles);
+  }
+  return path;
+}
+
+
+void ren::CameraPath::apply(Camera& camera, float time) const {
+  if (keyframes.empty()) return;
+  camera.velocity = glm::vec3(0.0f);
+
+  float duration = getDuration();
+  if (duration > 0.0f) time = fmodf(time, duration);
+
+  // Find the first keyframe after `time`, and blend from the one before it.
+  auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                               [](float t, const Keyframe& k) { return t < k.time; });
+  if (next == keyframes.begin() || next == keyframes.end()) {
+    auto& k = next == keyframes.end() ? keyframes.back() : keyframes.front();
+    camera.position = k.position;
+    camera.angles = k.angles;
+    return;
+  }
+
+  auto& a = *(next - 1);
+  auto& b = *next;
+  float t = (time - a.time) / (b.time - a.time);
+  camera.position = glm::mix(a.position, b.position, t);
+  camera.angles = glm::mix(a.angles, b.angles, t);
+}
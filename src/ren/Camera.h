@@ -29,7 +29,44 @@ namespace ren {
       return view;
     }
 
+    // Point the camera at `target` from where it is.
+    void lookAt(glm::vec3 target);
+
     void update(float dt);
   };
 
+
+  // A recorded camera path: keyframes of position and angles over time. Used
+  // by the benchmark runner to fly the same route every run, independent of
+  // input and of how fast frames are rendered.
+  class CameraPath {
+   public:
+    struct Keyframe {
+      float time;  // seconds
+      glm::vec3 position;
+      glm::vec3 angles;  // pitch, yaw, roll (like Camera::angles)
+    };
+
+    // Keyframes must be added in time order.
+    void addKeyframe(float time, glm::vec3 position, glm::vec3 angles);
+
+    // Load a path from a text file, one keyframe per line:
+    //   time x y z pitch yaw
+    // Lines starting with # are ignored. Throws if the file can't be read.
+    static CameraPath load(const std::string &filename);
+
+    // A circle around `center`, always looking at it.
+    static CameraPath orbit(glm::vec3 center, float radius, float height, float duration,
+                            int steps = 64);
+
+    // Place the camera where the path is at `time`. Loops past the end.
+    void apply(Camera &camera, float time) const;
+
+    float getDuration(void) const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+    bool empty(void) const { return keyframes.empty(); }
+
+   private:
+    std::vector<Keyframe> keyframes;
+  };
+
 }  // namespace ren
\ No newline at end of file
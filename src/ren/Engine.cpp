@@ -2,7 +2,6 @@
 
 #include <stb/stb_image.h>
 #include <ren/renderer/pipelines/StandardPipeline.h>
-#include <ren/renderer/pipelines/PointPipeline.h>
 #include <ren/renderer/Texture.h>
 #include <ren/renderer/Swapchain.h>
 #include <ren/Camera.h>
@@ -86,24 +85,6 @@ void generate_sphere(std::vector<ren::Vertex>& vertices, std::vector<uint32_t>&
 
 
 
-ren::ref<ren::PointPipeline> createPointPipeline(void) {
-  REN_PROFILE_FUNCTION();
-  auto& vulkan = ren::getVulkan();
-  VkDescriptorSetLayout descriptorSetLayout;
-
-  VkDescriptorSetLayoutCreateInfo layoutInfo{};
-  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-  layoutInfo.bindingCount = 0;
-  layoutInfo.pBindings = NULL;
-
-  if (vkCreateDescriptorSetLayout(vulkan.device, &layoutInfo, nullptr, &descriptorSetLayout) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to create descriptor set layout!");
-  }
-
-  return ren::makeRef<ren::PointPipeline>(descriptorSetLayout);
-}
-
 void ren::Engine::run(void) {
   // REN_PROFILE_FUNCTION();
 
@@ -120,8 +101,6 @@ void ren::Engine::run(void) {
   generate_sphere(vertices, indices, 1.0f, 64, 64, glm::vec3(1.0f, 1.0f, 1.0f));
 
 
-  auto pointPipeline = createPointPipeline();
-
   auto vertex_shader =
       makeRef<ren::Shader>("shaders/triangle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
   auto fragment_shader =
@@ -261,22 +240,6 @@ void ren::Engine::run(void) {
   auto lastTime = startTime;
 
 
-  float bounds = 2;
-  float moveSpeedRange = 1.0f;
-  std::vector<Vertex> pointVertices;
-  for (int i = 0; i < 50'000; i++) {
-    float distance = sqrt(ren::randomFloat(0.0f, 1.0f)) * 3.0f;
-    auto location = glm::vec3(ren::randomFloat(-1.0f, 1.0f) * bounds, 0.0f,
-                              ren::randomFloat(-1.0f, 1.0f) * bounds);
-
-    // the color is actually velocity.
-    // glm::vec3 color = glm::vec3(ren::randomFloat(0.0f, 0.05f));
-    glm::vec3 color = glm::vec3(0.0f);
-    // glm::vec3 color = ren::randomDirection() * ren::randomFloat(0.0f, moveSpeedRange);
-    pointVertices.push_back({location, color, glm::vec2(0.0f, 0.0f)});
-  }
-
-  auto pointVertexBuffer = makeRef<ren::VertexBuffer<ren::Vertex>>(*vulkan, pointVertices);
 
   float fov = 90.0f;
   float fNear = 0.01f;
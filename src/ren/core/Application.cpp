@@ -1,6 +1,9 @@
 
 #include <ren/core/Application.h>
 #include <ren/layers/ImGuiLayer.h>
+#include <ren/layers/ProfilerLayer.h>
+#include <ren/layers/SceneLayer.h>
+#include <ren/core/Benchmark.h>
 
 #include <imgui.h>
 #include <imgui_impl_vulkan.h>
@@ -9,21 +12,118 @@
 static ren::Application *g_application = nullptr;
 namespace ren {
 
+  static bool parsePresentMode(const std::string &name, ApplicationConfig &config) {
+    for (auto mode : Swapchain::PRESENT_MODES) {
+      if (name == Swapchain::getPresentModeName(mode)) {
+        config.presentMode = mode;
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  ApplicationConfig ApplicationConfig::fromArgs(int argc, char **argv) {
+    ApplicationConfig config;
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (arg == "--headless") {
+        config.headless = true;
+      } else if (arg == "--frames" && hasValue) {
+        config.maxFrames = std::stoull(argv[++i]);
+      } else if (arg == "--size" && hasValue &&
+                 sscanf(argv[++i], "%ux%u", &config.windowSize.x, &config.windowSize.y) == 2) {
+        // Parsed by sscanf
+      } else if (arg == "--no-vsync") {
+        config.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+      } else if (arg == "--present-mode" && hasValue && parsePresentMode(argv[++i], config)) {
+        // Parsed by parsePresentMode
+      } else if (arg == "--low-latency") {
+        config.lowLatency = true;
+      } else if (arg == "--fps-cap" && hasValue) {
+        config.fpsCap = std::stof(argv[++i]);
+      } else if (arg == "--frames-in-flight" && hasValue) {
+        config.framesInFlight = std::stoul(argv[++i]);
+      } else if (arg == "--no-direct-writes") {
+        config.directWrites = false;
+      } else if (arg == "--pipeline-cache" && hasValue) {
+        config.pipelineCachePath = argv[++i];
+      } else if (arg == "--no-pipeline-cache") {
+        config.pipelineCachePath.clear();
+      } else if (arg == "--scene" && hasValue) {
+        config.scene = argv[++i];
+      } else if (arg == "--particles" && hasValue) {
+        config.particles = std::stoul(argv[++i]);
+      } else if (arg == "--benchmark" && hasValue) {
+        config.benchmark = true;
+        config.scene = argv[++i];
+      } else if (arg == "--report" && hasValue) {
+        config.reportPath = argv[++i];
+      } else if (arg == "--camera-path" && hasValue) {
+        config.cameraPath = argv[++i];
+      } else {
+        fmt::print(stderr,
+                   "usage: {} [--headless] [--frames N] [--size WxH] [--no-vsync]\n"
+                   "       [--present-mode fifo|fifo-relaxed|mailbox|immediate]\n"
+                   "       [--low-latency] [--fps-cap N]\n"
+                   "       [--frames-in-flight N] [--no-direct-writes]\n"
+                   "       [--pipeline-cache PATH] [--no-pipeline-cache]\n"
+                   "       [--scene NAME] [--particles N]\n"
+                   "       [--benchmark NAME] [--report PATH] [--camera-path PATH]\n",
+                   argv[0]);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    if (config.benchmark) {
+      // Benchmarks should measure the renderer, not the display, and every run
+      // should draw exactly the same frames.
+      config.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+      config.lowLatency = false;
+      config.fpsCap = 0.0f;
+      config.fixedDeltaTime = 1.0f / 60.0f;
+      if (config.maxFrames == 0) config.maxFrames = 1000;
+      if (config.reportPath.empty()) {
+        config.reportPath = fmt::format("benchmark_{}.json", config.scene);
+      }
+    }
+    return config;
+  }
+
+
   Application &Application::get(void) { return *g_application; }
-  Application::Application(const std::string &app_name, glm::uvec2 window_size) {
+  Application::Application(const ApplicationConfig &config)
+      : config(config) {
     g_application = this;
-    // Initialize the SDL window
-    SDL_Init(SDL_INIT_VIDEO);
-    SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-    this->window =
-        SDL_CreateWindow(app_name.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                         window_size.x, window_size.y, window_flags);
-
-    this->renderer = makeRef<Renderer>(this->window);
-
-    // Add the ImGuiLayer to the stack.
-    auto imguiLayer = makeRef<ImGuiLayer>(*this);
-    this->layerStack.pushLayer(imguiLayer);
+    auto window_size = config.windowSize;
+
+    // The thread that creates the job system becomes its main thread.
+    this->jobs = makeBox<JobSystem>();
+
+    if (config.headless) {
+      // No SDL video at all, so this works without a display.
+      this->renderer = makeRef<Renderer>(nullptr, VkExtent2D{window_size.x, window_size.y});
+    } else {
+      // Initialize the SDL window
+      SDL_Init(SDL_INIT_VIDEO);
+      SDL_WindowFlags window_flags =
+          (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
+      this->window =
+          SDL_CreateWindow(config.name.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                           window_size.x, window_size.y, window_flags);
+
+      this->renderer = makeRef<Renderer>(this->window);
+
+      // Add the ImGuiLayer to the stack.
+      auto imguiLayer = makeRef<ImGuiLayer>(*this);
+      this->layerStack.pushLayer(imguiLayer);
+    }
+    this->layerStack.pushLayer(makeRef<ProfilerLayer>(*this));
+    // The scene goes on the bottom, so it draws first and is detached before ImGui.
+    this->layerStack.pushLayerBottom(makeRef<SceneLayer>(*this, config.scene));
+
+    if (config.benchmark) this->benchmark = makeBox<Benchmark>(this->config);
   }
 
   Application::~Application() {
@@ -37,7 +137,7 @@ namespace ren {
     this->renderer.reset();
 
     // And finally, close the SDL window
-    SDL_DestroyWindow(this->window);
+    if (this->window != nullptr) SDL_DestroyWindow(this->window);
     this->window = nullptr;
   }
 
@@ -48,11 +148,16 @@ namespace ren {
     auto startTime = std::chrono::high_resolution_clock::now();
     auto lastTime = startTime;
     SDL_Event e;
+    u64 frameCount = 0;
 
     while (this->running) {
       int eventsHandled = 0;
+      REN_PROFILE_FRAME();
       REN_PROFILE_SCOPE("Render Loop");
 
+      // Sleep off the time this frame would otherwise spend queued behind the
+      // GPU, before we sample any input for it.
+      renderer->getFrameLimiter().wait();
 
       auto currentTime = std::chrono::high_resolution_clock::now();
       float time =
@@ -62,8 +167,15 @@ namespace ren {
           std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTime)
               .count();
       lastTime = currentTime;
+      // The real frame time is what we measure, the fixed one is what we simulate.
+      float frameTime = deltaTime;
+      if (config.fixedDeltaTime > 0.0f) deltaTime = config.fixedDeltaTime;
+
+      // Run anything the workers handed back to the main thread (SDL calls, mostly).
+      jobs->pumpMainThread();
 
-      {
+      // There is no SDL event loop when headless.
+      if (!isHeadless()) {
         bool windowResized = false;
         REN_PROFILE_SCOPE("SDL Poll");
         // Handle events on queue
@@ -93,13 +205,14 @@ namespace ren {
       renderer->beginFrame();
 
       // Render the scene.
+      layerStack.onRender();
 
       // Called to blit the render target to the swapchain.
       renderer->finalizeScene();
 
       // Then, we render imgui.
 
-      {
+      if (!isHeadless()) {
         REN_PROFILE_SCOPE("ImGui Render");
         {
           REN_PROFILE_SCOPE("ImGui New Frame");
@@ -115,17 +228,30 @@ namespace ren {
         {
           REN_PROFILE_SCOPE("ImGui Render Draw Data");
           ImGui::Render();
-          // Gross leakage.
-          ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), ren::getFrameData().commandBuffer);
+          // ImGui draws over everything else, so it goes last.
+          auto cmd = renderer->beginCommands(Renderer::ORDER_UI);
+          {
+            REN_GPU_SCOPE(cmd, "ImGui");
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+          }
+          renderer->endCommands(cmd);
         }
       }
 
       renderer->endFrame();
-
+      if (benchmark) benchmark->addFrame(frameTime);
 
 
       // Update the layers.
       layerStack.onUpdate(deltaTime);
+
+      frameCount++;
+      if (config.maxFrames != 0 && frameCount >= config.maxFrames) this->running = false;
+    }
+
+    if (benchmark) {
+      renderer->waitForIdle();
+      benchmark->writeReport(config.reportPath);
     }
   }
 
@@ -5,21 +5,75 @@
 #include <SDL2/SDL.h>
 #include <ren/renderer/RenderPass.h>
 #include <ren/renderer/Renderer.h>
+#include <ren/core/JobSystem.h>
 namespace ren {
 
+  class Benchmark;
+
+
+  // How to set up the application. Usually filled in from the command line.
+  struct ApplicationConfig {
+    std::string name = "ren";
+    glm::uvec2 windowSize = {1920, 1080};
+    // Render into offscreen images, with no window, surface or ImGui. The
+    // window size is used as the size of the offscreen images.
+    bool headless = false;
+    // Stop after this many frames. 0 runs until the window is closed.
+    u64 maxFrames = 0;
+    // Which scene the SceneLayer loads.
+    std::string scene = "planets";
+    // How many GPU simulated particles orbit the planets. 0 turns them off.
+    u32 particles = 50'000;
+    // What the swapchain presents with (see Swapchain). Can be changed at runtime.
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Pace frames for input latency, and optionally cap the framerate (see FrameLimiter).
+    bool lowLatency = false;
+    float fpsCap = 0.0f;
+    // How many frames the CPU can record while the GPU is still busy with
+    // earlier ones, up to MAX_FRAMES_IN_FLIGHT. Fewer gives lower input
+    // latency, more keeps a GPU bound scene from stalling on the CPU.
+    u32 framesInFlight = 2;
+    // Write static buffers in place when the GPU's memory is host visible
+    // (resizable BAR, integrated GPUs), instead of staging them (see MemoryPools).
+    bool directWrites = true;
+    // Where the driver's compiled pipelines are kept between runs (see
+    // PipelineCache). Empty doesn't keep them.
+    std::string pipelineCachePath = "pipeline.cache";
+    // If non-zero, every frame advances the simulation by exactly this much,
+    // no matter how long it really took.
+    float fixedDeltaTime = 0.0f;
+
+    // Benchmark mode replays a camera path over the scene and writes a JSON
+    // report to reportPath when the run is over.
+    bool benchmark = false;
+    std::string reportPath;
+    // A camera path file (see CameraPath::load). Empty orbits the scene.
+    std::string cameraPath;
+
+    // Understands --headless, --frames N, --size WxH, --no-vsync (MAILBOX),
+    // --present-mode fifo|fifo-relaxed|mailbox|immediate, --low-latency,
+    // --fps-cap N, --frames-in-flight N, --no-direct-writes, --pipeline-cache PATH,
+    // --no-pipeline-cache, --scene NAME, --particles N, --benchmark NAME, --report PATH
+    // and --camera-path PATH. Exits on anything else.
+    static ApplicationConfig fromArgs(int argc, char **argv);
+  };
 
 
   class Application {
+    // Declared first so it's torn down last: anything below may still have jobs in flight.
+    box<JobSystem> jobs;
     // The first important thing in an application is the SDL Window and the Vulkan instance.
     SDL_Window *window = nullptr;
     ref<Renderer> renderer;
 
     ren::LayerStack layerStack;
+    box<Benchmark> benchmark;
 
     bool running = true;
+    ApplicationConfig config;
 
    public:
-    Application(const std::string &app_name, glm::uvec2 window_size);
+    Application(const ApplicationConfig &config);
     ~Application();
 
     void run();
@@ -28,6 +82,8 @@ namespace ren {
     static Application &get(void);
 
     SDL_Window *getWindow(void) const { return this->window; }
+    bool isHeadless(void) const { return config.headless; }
+    const ApplicationConfig &getConfig(void) const { return config; }
 
 
    private:
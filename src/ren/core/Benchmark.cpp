@@ -0,0 +1,144 @@
+#include <ren/core/Benchmark.h>
+#include <ren/core/Application.h>
+#include <ren/renderer/Renderer.h>
+#include <ren/renderer/GpuProfiler.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace ren {
+
+  struct TimeSummary {
+    double mean = 0, p50 = 0, p90 = 0, p95 = 0, p99 = 0, max = 0;
+  };
+
+
+  static TimeSummary summarize(std::vector<double> times) {
+    TimeSummary summary;
+    if (times.empty()) return summary;
+
+    std::sort(times.begin(), times.end());
+    auto percentile = [&](double p) { return times[static_cast<size_t>(p * (times.size() - 1))]; };
+
+    double total = 0;
+    for (double time : times) total += time;
+    summary.mean = total / times.size();
+    summary.p50 = percentile(0.50);
+    summary.p90 = percentile(0.90);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = times.back();
+    return summary;
+  }
+
+
+  // Just enough escaping for the paths and names we write.
+  static std::string jsonString(const std::string &str) {
+    std::string out = "\"";
+    for (char c : str) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        out += fmt::format("\\u{:04x}", static_cast<int>(c));
+      } else {
+        out += c;
+      }
+    }
+    return out + "\"";
+  }
+
+
+  static std::string jsonSummary(const TimeSummary &s) {
+    return fmt::format(
+        "{{\"mean\": {:.4f}, \"p50\": {:.4f}, \"p90\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, "
+        "\"max\": {:.4f}}}",
+        s.mean, s.p50, s.p90, s.p95, s.p99, s.max);
+  }
+
+
+  Benchmark::Benchmark(const ApplicationConfig &config)
+      : config(config) {
+    cpuTimes.reserve(config.maxFrames);
+    gpuTimes.reserve(config.maxFrames);
+    GpuProfiler::get().setKeepFrameTimes(true);
+  }
+
+
+  void Benchmark::addFrame(float deltaTime) {
+    // GPU timings arrive a few frames late, and not at all if the queue has no
+    // timestamps. Take each one as it's collected, so none is counted twice or
+    // skipped when the CPU and GPU run at different rates.
+    for (u64 gpuTime : GpuProfiler::get().takeFrameTimes()) {
+      if (gpuFrames++ >= WARMUP_FRAMES) gpuTimes.push_back(gpuTime / 1000000.0);
+    }
+
+    if (frames++ < WARMUP_FRAMES) return;
+
+    cpuTimes.push_back(deltaTime * 1000.0);
+    drawCalls += Renderer::get().getStats().drawCalls;
+  }
+
+
+  void Benchmark::writeReport(const std::string &path) const {
+    auto &vulkan = getVulkan();
+    auto cpu = summarize(cpuTimes);
+    auto gpu = summarize(gpuTimes);
+    u64 measured = cpuTimes.size();
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vulkan.physical_device, &properties);
+
+    std::string out;
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "{{\n");
+    fmt::format_to(it, "  \"scene\": {},\n", jsonString(config.scene));
+    fmt::format_to(it, "  \"device\": {},\n", jsonString(properties.deviceName));
+    fmt::format_to(it, "  \"resolution\": [{}, {}],\n", Renderer::get().getExtent().width,
+                   Renderer::get().getExtent().height);
+    fmt::format_to(it, "  \"headless\": {},\n", config.headless);
+    fmt::format_to(it, "  \"framesInFlight\": {},\n", Renderer::get().getFrameCount());
+    fmt::format_to(it, "  \"fixedDeltaTime\": {},\n", config.fixedDeltaTime);
+    fmt::format_to(it, "  \"frames\": {},\n", frames);
+    fmt::format_to(it, "  \"warmupFrames\": {},\n", std::min<u64>(frames, WARMUP_FRAMES));
+    fmt::format_to(it, "  \"cpuFrameTimeMs\": {},\n", jsonSummary(cpu));
+    fmt::format_to(it, "  \"gpuFrameTimeMs\": {},\n", jsonSummary(gpu));
+    fmt::format_to(it, "  \"drawCalls\": {{\"total\": {}, \"perFrame\": {:.2f}}},\n", drawCalls,
+                   measured > 0 ? static_cast<double>(drawCalls) / measured : 0.0);
+
+    // ---- Memory, per VMA heap ---- //
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkan.allocator, &memoryProperties);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(vulkan.allocator, budgets.data());
+
+    fmt::format_to(it, "  \"memoryHeaps\": [\n");
+    for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+      auto &heap = memoryProperties->memoryHeaps[i];
+      auto &budget = budgets[i];
+      fmt::format_to(it,
+                     "    {{\"heap\": {}, \"deviceLocal\": {}, \"size\": {}, \"budget\": {}, "
+                     "\"usage\": {}, \"blockBytes\": {}, \"allocationBytes\": {}, "
+                     "\"allocations\": {}}}{}\n",
+                     i, (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0, heap.size,
+                     budget.budget, budget.usage, budget.statistics.blockBytes,
+                     budget.statistics.allocationBytes, budget.statistics.allocationCount,
+                     i + 1 < memoryProperties->memoryHeapCount ? "," : "");
+    }
+    fmt::format_to(it, "  ],\n");
+
+    std::string trace = Instrumentor::Get().getSessionPath();
+    fmt::format_to(it, "  \"trace\": {}\n", trace.empty() ? "null" : jsonString(trace));
+    fmt::format_to(it, "}}\n");
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("failed to open benchmark report " + path);
+    file << out;
+
+    fmt::println("Benchmark '{}': {} frames, cpu p50 {:.2f}ms p99 {:.2f}ms, gpu p50 {:.2f}ms",
+                 config.scene, measured, cpu.p50, cpu.p99, gpu.p50);
+    fmt::println("Benchmark report written to {}", path);
+  }
+
+}  // namespace ren
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ren/types.h>
+
+namespace ren {
+
+  struct ApplicationConfig;
+
+  // Collects per-frame timings during a `--benchmark` run and writes them out
+  // as a JSON report. Every frame of the run is kept (a run is a few thousand
+  // frames at most), so the percentiles are exact.
+  class Benchmark {
+   public:
+    // The first few frames pay for pipeline creation, first-touch page
+    // faults and so on, so they aren't counted.
+    static constexpr u32 WARMUP_FRAMES = 10;
+
+    Benchmark(const ApplicationConfig &config);
+
+    // Call once the frame has been submitted. `deltaTime` is the real wall
+    // clock time of the frame in seconds, not the fixed simulation step.
+    void addFrame(float deltaTime);
+
+    // Write the report, and print a short summary to stdout.
+    void writeReport(const std::string &path) const;
+
+   private:
+    const ApplicationConfig &config;
+    u64 frames = 0;
+    u64 gpuFrames = 0;
+    std::vector<double> cpuTimes;  // ms
+    std::vector<double> gpuTimes;  // ms
+    u64 drawCalls = 0;
+  };
+
+}  // namespace ren
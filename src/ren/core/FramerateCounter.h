@@ -1,23 +1,140 @@
 #pragma once
 #include <ren/types.h>
+#include <ren/core/Instrumentation.h>
+#include <bit>
 
 
 namespace ren {
+
+  // A histogram of frame times with log-spaced (HDR-style) buckets. Each power
+  // of two is split into 2^SUB_BITS linear buckets, so every bucket is within
+  // ~3% of the frame times it holds, from 1us up to ~16s, in a few hundred
+  // counters. Inserting is O(1). The histogram covers a sliding window of the
+  // last N frames: a ring of bucket indices remembers which bucket to
+  // decrement when a frame falls out of the window.
+  class FrameTimeHistogram {
+   public:
+    static constexpr u32 SUB_BITS = 5;
+    static constexpr u32 SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr u32 MAX_BIT = 24;  // 2^24us, about 16 seconds.
+    static constexpr u32 BUCKET_COUNT = (MAX_BIT - SUB_BITS + 2) * SUB_BUCKETS;
+
+    FrameTimeHistogram(u32 window)
+        : window(std::max<u32>(window, 1))
+        , ring(this->window, 0) {}
+
+    // Add a frame. `stutter` is decided by the caller, since it depends on
+    // the average at the time the frame happened, not the window's average.
+    void add(float deltaTime, bool stutter) {
+      u64 micros = static_cast<u64>(std::max(deltaTime, 0.0f) * 1000000.0f);
+      u16 bucket = static_cast<u16>(bucketFor(micros));
+
+      if (count == window) {
+        // Evict the oldest frame.
+        u16 old = ring[head];
+        buckets[old & BUCKET_MASK]--;
+        sum -= bucketMicros(old & BUCKET_MASK);
+        if (old & STUTTER_BIT) stutters--;
+      } else {
+        count++;
+      }
+
+      ring[head] = bucket | (stutter ? STUTTER_BIT : 0);
+      head = (head + 1) % window;
+      buckets[bucket]++;
+      sum += bucketMicros(bucket);
+      if (stutter) stutters++;
+    }
+
+    // The frame time (in seconds) that `fraction` of the frames are faster than.
+    float percentile(float fraction) const {
+      if (count == 0) return 0.0f;
+      u64 target = static_cast<u64>(fraction * (count - 1)) + 1;
+      u64 seen = 0;
+      for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen >= target) return bucketMicros(i) / 1000000.0f;
+      }
+      return bucketMicros(BUCKET_COUNT - 1) / 1000000.0f;
+    }
+
+    // The average framerate of the slowest `fraction` of frames (the "1% low" for 0.01).
+    float lowFramerate(float fraction) const {
+      if (count == 0) return 0.0f;
+      u64 wanted = std::max<u64>(static_cast<u64>(count * fraction), 1);
+      u64 taken = 0;
+      u64 total = 0;
+      for (u32 i = BUCKET_COUNT; i-- > 0 && taken < wanted;) {
+        u64 n = std::min<u64>(buckets[i], wanted - taken);
+        taken += n;
+        total += n * bucketMicros(i);
+      }
+      return total > 0 ? taken * 1000000.0f / total : 0.0f;
+    }
+
+    float getAverageDeltaTime(void) const { return count > 0 ? sum / 1000000.0f / count : 0.0f; }
+    u32 getStutters(void) const { return stutters; }
+    u32 getFrameCount(void) const { return count; }
+    u32 getWindow(void) const { return window; }
+
+   private:
+    static constexpr u16 STUTTER_BIT = 0x8000;
+    static constexpr u16 BUCKET_MASK = 0x7FFF;
+    static_assert(BUCKET_COUNT <= BUCKET_MASK);
+
+    static u32 bucketFor(u64 micros) {
+      if (micros < SUB_BUCKETS) return static_cast<u32>(micros);
+      u32 msb = std::min<u32>(std::bit_width(micros) - 1, MAX_BIT);
+      if (msb == MAX_BIT) return BUCKET_COUNT - 1;
+      // Keep the top SUB_BITS + 1 bits. The leading one picks the power of two,
+      // the rest pick the linear bucket inside it.
+      u64 mantissa = micros >> (msb - SUB_BITS);
+      return (msb - SUB_BITS + 1) * SUB_BUCKETS + static_cast<u32>(mantissa - SUB_BUCKETS);
+    }
+
+    // The midpoint of a bucket, in microseconds.
+    static u64 bucketMicros(u32 bucket) {
+      if (bucket < SUB_BUCKETS) return bucket;
+      u32 group = bucket / SUB_BUCKETS;
+      u64 mantissa = bucket % SUB_BUCKETS + SUB_BUCKETS;
+      u64 low = mantissa << (group - 1);
+      u64 high = (mantissa + 1) << (group - 1);
+      return (low + high) / 2;
+    }
+
+    u32 window;
+    u32 head = 0;
+    u32 count = 0;
+    u32 stutters = 0;
+    u64 sum = 0;  // microseconds, of the bucket midpoints
+    std::vector<u16> ring;
+    std::array<u32, BUCKET_COUNT> buckets = {};
+  };
+
+
   // This is a class that provides a simple framerate counter by providing a delta time.
   // it tracks frame times and gives an average over the past 10 frames.
   // it uses a fixed sized array to store the frame times and implements it using
   // a circular buffer.
+  //
+  // On top of that it keeps a FrameTimeHistogram for each of a set of longer
+  // windows, which give the percentiles and lows that an average hides. A
+  // frame counts as a stutter if it takes more than STUTTER_FACTOR times the
+  // 10 frame average before it.
 
   constexpr int FRAMERATE_TRACKER_SIZE = 10;
+  constexpr float STUTTER_FACTOR = 2.0f;
   class FramerateCounter {
    private:
     float deltaTimes[FRAMERATE_TRACKER_SIZE];
     size_t head;
     size_t count;
     float sum;
+    std::vector<FrameTimeHistogram> histograms;
 
    public:
-    FramerateCounter()
+    // The windows (in frames) to keep histograms for. About 1s, 10s and 1m at 60Hz.
+    FramerateCounter(std::vector<u32> windows = {60, 600, 3600})
         : head(0)
         , count(0)
         , sum(0.0f) {
@@ -25,9 +142,18 @@ namespace ren {
       for (size_t i = 0; i < FRAMERATE_TRACKER_SIZE; ++i) {
         deltaTimes[i] = 0.0f;
       }
+      for (u32 window : windows) {
+        histograms.emplace_back(window);
+      }
     }
 
     void addFrame(float deltaTime) {
+      // Judge the frame against the average *before* it is included.
+      bool stutter = isFull() && deltaTime > STUTTER_FACTOR * getAverageDeltaTime();
+      for (auto &histogram : histograms) {
+        histogram.add(deltaTime, stutter);
+      }
+
       // Remove old value from sum if buffer is full
       if (count == FRAMERATE_TRACKER_SIZE) {
         sum -= deltaTimes[head];
@@ -54,6 +180,19 @@ namespace ren {
 
     bool isFull() const { return count == FRAMERATE_TRACKER_SIZE; }
 
+    const std::vector<FrameTimeHistogram> &getHistograms() const { return histograms; }
+
+    // Write the first (shortest) window's numbers as trace counters.
+    void emitCounters() const {
+      REN_PROFILE_COUNTER("FPS", getAverageFramerate());
+      if (histograms.empty()) return;
+      auto &histogram = histograms.front();
+      REN_PROFILE_COUNTER("FPS 1% Low", histogram.lowFramerate(0.01f));
+      REN_PROFILE_COUNTER("FPS 0.1% Low", histogram.lowFramerate(0.001f));
+      REN_PROFILE_COUNTER("Frame Time p99 (ms)", histogram.percentile(0.99f) * 1000.0f);
+      REN_PROFILE_COUNTER("Stutters", histogram.getStutters());
+    }
+
     void reset() {
       head = 0;
       count = 0;
@@ -61,7 +200,10 @@ namespace ren {
       for (size_t i = 0; i < FRAMERATE_TRACKER_SIZE; ++i) {
         deltaTimes[i] = 0.0f;
       }
+      for (auto &histogram : histograms) {
+        histogram = FrameTimeHistogram(histogram.getWindow());
+      }
     }
   };
 
-}  // namespace ren
\ No newline at end of file
+}  // namespace ren
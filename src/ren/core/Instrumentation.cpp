@@ -0,0 +1,196 @@
+#include <ren/core/Instrumentation.h>
+
+#include <stdexcept>
+
+namespace ren {
+
+  // How often the flusher wakes up to drain the ring buffers. Each buffer holds
+  // TraceRingBuffer::Capacity events, so this needs to be short enough that a
+  // busy thread can't fill its buffer in between.
+  static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
+
+
+  void Instrumentor::BeginSession(const std::string& name, const std::string& filepath) {
+    // If there is already a current session, then close it before beginning new one.
+    // Subsequent profiling output meant for the original session will end up in the
+    // newly opened session instead.  That's better than having badly formatted
+    // profiling output.
+    EndSession();
+
+    std::lock_guard lock(m_Mutex);
+    if (m_Writer.open(filepath)) {
+      m_SessionName = name;
+      m_SessionPath = filepath;
+      m_Encoder = trace::Encoder{};
+      m_Encoder.writeHeader(m_Writer.buffer());
+      for (uint32_t i = 0; i < m_Tracks.size(); i++) {
+        m_Encoder.writeTrack(m_Writer.buffer(), FIRST_TRACK_ID + i, m_Tracks[i]);
+      }
+
+      m_SessionActive = true;
+      updateRecording();
+      startFlusher();
+    }
+  }
+
+
+  std::string Instrumentor::getSessionPath(void) {
+    std::lock_guard lock(m_Mutex);
+    return m_SessionActive ? m_SessionPath : std::string();
+  }
+
+
+  void Instrumentor::EndSession() {
+    std::unique_lock lock(m_Mutex);
+    if (!m_SessionActive) return;
+
+    InternalEndSession();
+    if (!m_LiveStats) stopFlusher(lock);
+  }
+
+
+  void Instrumentor::enableLiveStats(bool enable) {
+    std::unique_lock lock(m_Mutex);
+    if (m_LiveStats == enable) return;
+
+    m_LiveStats = enable;
+    updateRecording();
+    if (enable) {
+      startFlusher();
+    } else if (!m_SessionActive) {
+      stopFlusher(lock);
+    }
+  }
+
+
+  void Instrumentor::InternalEndSession() {
+    if (!m_SessionActive) return;
+
+    // Anything still sitting in the ring buffers belongs to this session.
+    drainBuffers();
+
+    m_SessionActive = false;
+    updateRecording();
+    m_Writer.close();
+  }
+
+
+  uint64_t Instrumentor::droppedEvents(void) {
+    std::lock_guard lock(m_BuffersMutex);
+    uint64_t dropped = 0;
+    for (auto& buffer : m_Buffers) {
+      dropped += buffer->getDropped();
+    }
+    return dropped;
+  }
+
+
+  uint32_t Instrumentor::createTrack(const char* name) {
+    std::lock_guard lock(m_Mutex);
+    if (m_Tracks.size() >= MAX_TRACKS) {
+      throw std::runtime_error(std::string("Instrumentor: out of tracks for ") + name);
+    }
+    uint32_t track = FIRST_TRACK_ID + static_cast<uint32_t>(m_Tracks.size());
+    m_Tracks.push_back(name);
+    if (m_SessionActive) m_Encoder.writeTrack(m_Writer.buffer(), track, name);
+    return track;
+  }
+
+
+  TraceRingBuffer* Instrumentor::registerThread(void) {
+    std::lock_guard lock(m_BuffersMutex);
+    auto index = static_cast<uint32_t>(m_Buffers.size());
+    // Step over the IDs reserved for tracks.
+    if (index >= FIRST_TRACK_ID) index += MAX_TRACKS;
+    m_Buffers.push_back(std::make_unique<TraceRingBuffer>(index));
+    return m_Buffers.back().get();
+  }
+
+
+  void Instrumentor::startFlusher(void) {
+    if (m_Flusher.joinable()) return;
+    m_StopFlusher = false;
+    m_Flusher = std::thread(&Instrumentor::flusherMain, this);
+  }
+
+
+  void Instrumentor::stopFlusher(std::unique_lock<std::mutex>& lock) {
+    if (!m_Flusher.joinable()) return;
+
+    // The flusher needs m_Mutex to drain, so we can't hold it while joining.
+    m_StopFlusher = true;
+    lock.unlock();
+    m_FlushCondition.notify_all();
+    m_Flusher.join();
+    lock.lock();
+
+    // Whatever was recorded since the last drain has nowhere to go now.
+    drainBuffers();
+  }
+
+
+  void Instrumentor::flusherMain(void) {
+    std::unique_lock lock(m_Mutex);
+    while (!m_StopFlusher) {
+      m_FlushCondition.wait_for(lock, FLUSH_INTERVAL, [this] { return m_StopFlusher; });
+      drainBuffers();
+    }
+  }
+
+
+  void Instrumentor::drainBuffers(void) {
+    // Take a snapshot of the buffer list so threads registering themselves
+    // don't have to wait for us to finish writing.
+    std::vector<TraceRingBuffer*> buffers;
+    {
+      std::lock_guard lock(m_BuffersMutex);
+      buffers.reserve(m_Buffers.size());
+      for (auto& buffer : m_Buffers) {
+        buffers.push_back(buffer.get());
+      }
+    }
+
+    for (auto* buffer : buffers) {
+      uint32_t threadIndex = buffer->getThreadIndex();
+      buffer->drain([&](const TraceEvent& event) { writeEvent(threadIndex, event); });
+    }
+  }
+
+
+  void Instrumentor::writeEvent(uint32_t threadIndex, const TraceEvent& event) {
+    if (m_LiveStats) {
+      if (event.type == TraceEventType::Frame && event.track != 0) {
+        m_Stats.endGpuFrame();
+      } else if (event.type == TraceEventType::Frame) {
+        m_Stats.endFrame(event.timestamp);
+      } else {
+        m_Stats.add(threadIndex, event);
+      }
+    }
+
+    // With only live stats enabled, events are still recorded but not written.
+    if (!m_SessionActive || !m_OutputEnabled) return;
+
+    auto& out = m_Writer.buffer();
+    size_t before = out.size();
+    if (event.track != 0) threadIndex = event.track;
+
+    switch (event.type) {
+      case TraceEventType::Complete:
+        m_Encoder.writeComplete(out, threadIndex, event.name, event.timestamp, event.duration);
+        break;
+      case TraceEventType::Instant:
+      case TraceEventType::Frame:
+        m_Encoder.writeInstant(out, threadIndex, event.name, event.timestamp);
+        break;
+      case TraceEventType::Counter:
+        m_Encoder.writeCounter(out, threadIndex, event.name, event.timestamp, event.value);
+        break;
+    }
+
+    profileBytes += out.size() - before;
+    profileEvents++;
+    m_Writer.commit();
+  }
+
+}  // namespace ren
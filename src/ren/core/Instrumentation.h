@@ -2,119 +2,180 @@
 
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <fstream>
-#include <iomanip>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <thread>
 #include <mutex>
-#include <sstream>
+#include <vector>
+
+#include <ren/core/ProfileStats.h>
+#include <ren/core/TraceFormat.h>
+#include <ren/core/TraceWriter.h>
 
 #define REN_PROFILE
 
 namespace ren {
 
 
+  // Nanoseconds on the steady clock. Every trace event is stamped with this.
+  inline uint64_t profileNow(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
 
-  using FloatingPointMicroseconds = std::chrono::duration<double, std::micro>;
-
-  struct ProfileResult {
-    std::string Name;
+  enum class TraceEventType : uint8_t {
+    Complete,  // A scope with a start and a duration
+    Instant,   // A single point in time (REN_PROFILE_MARK)
+    Counter,   // A named value at a point in time (REN_PROFILE_COUNTER)
+    Frame,     // The start of a new frame (REN_PROFILE_FRAME), or the end of a GPU frame
+  };
 
-    FloatingPointMicroseconds Start;
-    std::chrono::microseconds ElapsedTime;
-    std::thread::id ThreadID;
-    char ph = 'X';
+  // Tracks that aren't CPU threads (see Instrumentor::createTrack) get the IDs
+  // in [FIRST_TRACK_ID, FIRST_TRACK_ID + MAX_TRACKS). Thread indices skip over
+  // that range, so the two never collide no matter how many threads there are.
+  constexpr uint32_t FIRST_TRACK_ID = 256;
+  constexpr uint32_t MAX_TRACKS = 16;
+
+  // A single binary trace event. This is what the hot path writes into the
+  // per-thread ring buffers, so it must stay small and trivially copyable.
+  // `name` must point at storage that outlives the session (string literals,
+  // or the static strings that REN_PROFILE_SCOPE creates).
+  struct TraceEvent {
+    const char* name;
+    uint64_t timestamp;  // ns, see profileNow()
+    union {
+      uint64_t duration;  // ns, for Complete events
+      double value;       // for Counter events
+    };
+    // Which track the event goes on. 0 means the thread that recorded it.
+    uint32_t track = 0;
+    TraceEventType type = TraceEventType::Complete;
   };
 
-  struct InstrumentationSession {
-    std::string Name;
+
+  // A single-producer single-consumer ring of trace events. The owning thread
+  // pushes, and the Instrumentor's flusher thread drains. Neither side ever
+  // takes a lock. If the flusher falls behind, new events are dropped (and
+  // counted) rather than blocking the producer.
+  class TraceRingBuffer {
+   public:
+    static constexpr size_t Capacity = 1 << 14;  // Must be a power of two.
+
+    TraceRingBuffer(uint32_t threadIndex)
+        : m_ThreadIndex(threadIndex) {}
+
+    inline bool push(const TraceEvent& event) {
+      size_t head = m_Head.load(std::memory_order_relaxed);
+      if (head - m_CachedTail >= Capacity) {
+        // Only touch the consumer's cache line when we think we're full.
+        m_CachedTail = m_Tail.load(std::memory_order_acquire);
+        if (head - m_CachedTail >= Capacity) {
+          m_Dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      }
+      m_Events[head & (Capacity - 1)] = event;
+      m_Head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side. Calls `fn` on every pending event, in order.
+    template <typename Fn>
+    size_t drain(Fn&& fn) {
+      size_t tail = m_Tail.load(std::memory_order_relaxed);
+      size_t head = m_Head.load(std::memory_order_acquire);
+      for (size_t i = tail; i != head; i++) {
+        fn(m_Events[i & (Capacity - 1)]);
+      }
+      m_Tail.store(head, std::memory_order_release);
+      return head - tail;
+    }
+
+    uint32_t getThreadIndex(void) const { return m_ThreadIndex; }
+    uint64_t getDropped(void) const { return m_Dropped.load(std::memory_order_relaxed); }
+
+   private:
+    // Keep the producer and consumer indices on separate cache lines.
+    alignas(64) std::atomic<size_t> m_Head{0};
+    size_t m_CachedTail = 0;  // Producer's last view of m_Tail.
+    alignas(64) std::atomic<size_t> m_Tail{0};
+    alignas(64) std::atomic<uint64_t> m_Dropped{0};
+    uint32_t m_ThreadIndex;
+    TraceEvent m_Events[Capacity];
   };
 
+
+
+  // The Instrumentor collects trace events from every thread and writes them
+  // out in the binary trace format (see TraceFormat.h). Recording is lock-free:
+  // each thread gets its own TraceRingBuffer on first use, and a background
+  // flusher thread periodically drains them all and encodes them. The encoded
+  // bytes are written to disk by the TraceWriter's own IO thread.
+  //
+  // Independently of any session, the flusher can also feed the events into
+  // a ProfileStats, which keeps rolling per-scope numbers for the live
+  // profiler panel (see enableLiveStats).
   class Instrumentor {
    public:
-    uint64_t profileEvents = 0;
-    uint64_t profileBytes = 0;
+    std::atomic<uint64_t> profileEvents = 0;
+    std::atomic<uint64_t> profileBytes = 0;
     Instrumentor(const Instrumentor&) = delete;
     Instrumentor(Instrumentor&&) = delete;
 
-    void BeginSession(const std::string& name, const std::string& filepath = "results.json") {
-      std::lock_guard lock(m_Mutex);
-      if (m_CurrentSession) {
-        // If there is already a current session, then close it before beginning new one.
-        // Subsequent profiling output meant for the original session will end up in the
-        // newly opened session instead.  That's better than having badly formatted
-        // profiling output.
-        InternalEndSession();
-      }
-      m_OutputStream.open(filepath);
+    void BeginSession(const std::string& name, const std::string& filepath = "results.rtrace");
+    void EndSession();
+    // Where the current session is being written, or "" if there isn't one.
+    std::string getSessionPath(void);
 
-      if (m_OutputStream.is_open()) {
-        m_CurrentSession = new InstrumentationSession({name});
-        WriteHeader();
-      }
+    template <typename T>
+    inline void writeCounter(const char* name, T value) {
+      TraceEvent event;
+      event.name = name;
+      event.timestamp = profileNow();
+      event.value = static_cast<double>(value);
+      event.type = TraceEventType::Counter;
+      record(event);
     }
 
-    void EndSession() {
-      std::lock_guard lock(m_Mutex);
-      InternalEndSession();
+    inline void record(const TraceEvent& event) {
+      if (!m_Recording.load(std::memory_order_relaxed)) return;
+      threadBuffer().push(event);
     }
 
-    template <typename T>
-    inline void writeCounter(const char* name, T value) {
-      if (!m_OutputEnabled) return;
-
-      std::stringstream json;
-      json << std::setprecision(3) << std::fixed;
-      json << ",{";
-      json << "\"name\":\"" << name << "\",";
-      json << "\"ph\":\"C\",";
-      json << "\"pid\":\"0\",";
-      json << "\"tid\":\"" << std::this_thread::get_id() << "\",";
-      json
-          << "\"ts\":"
-          << FloatingPointMicroseconds{std::chrono::steady_clock::now().time_since_epoch()}.count();
-      json << ",\"args\":{\"value\":" << value << "}";
-      json << "}";
-
-      writeEvent(json.str());
+    void enableOutput(bool enable) {
+      m_OutputEnabled.store(enable, std::memory_order_relaxed);
+      updateRecording();
     }
 
+    inline bool isOutputEnabled() const { return m_OutputEnabled.load(std::memory_order_relaxed); }
 
-    inline void writeEvent(const std::string& event) {
-      profileBytes += event.size();
-      profileEvents++;
-      m_OutputStream << event;
+    // Mark the start of a new frame. The live stats are bucketed by these.
+    inline void markFrame(void) {
+      TraceEvent event;
+      event.name = "Frame";
+      event.timestamp = profileNow();
+      event.duration = 0;
+      event.type = TraceEventType::Frame;
+      record(event);
     }
 
-    inline void WriteProfile(const ProfileResult& result) {
-      if (!m_OutputEnabled) return;
-
-      std::lock_guard lock(m_Mutex);
-      if (m_CurrentSession) {
-        std::stringstream json;
-
-        json << std::setprecision(3) << std::fixed;
-        json << ",{";
-        json << "\"cat\":\"function\",";
-        json << "\"dur\":" << (result.ElapsedTime.count()) << ',';
-        json << "\"name\":\"" << result.Name << "\",";
-        json << "\"ph\":\"X\",";
-        json << "\"pid\":\"0\",";
-        json << "\"tid\":\"" << result.ThreadID << "\",";
-        json << "\"ts\":" << result.Start.count();
-        json << "}";
-
-        writeEvent(json.str());
-      }
-    }
+    // Keep recording (even with no session open) so the live stats stay up to date.
+    void enableLiveStats(bool enable);
+    inline bool isLiveStatsEnabled() const { return m_LiveStats.load(std::memory_order_relaxed); }
+    ProfileStats& getStats(void) { return m_Stats; }
 
-    void enableOutput(bool enable) {
-      std::lock_guard lock(m_Mutex);
-      m_OutputEnabled = enable;
-    }
+    // How many events were lost because a thread's ring buffer was full.
+    uint64_t droppedEvents(void);
 
-    inline bool isOutputEnabled() const { return m_OutputEnabled; }
+    // Create a named track for events that don't belong to a CPU thread (GPU
+    // timings, for example). Record onto it by setting TraceEvent::track.
+    // Throws once all MAX_TRACKS are taken.
+    uint32_t createTrack(const char* name);
 
     static Instrumentor& Get() {
       static Instrumentor instance;
@@ -123,37 +184,67 @@ namespace ren {
 
 
    private:
-    Instrumentor()
-        : m_CurrentSession(nullptr) {}
+    Instrumentor() = default;
 
-    ~Instrumentor() { EndSession(); }
+    ~Instrumentor() {
+      EndSession();
+      enableLiveStats(false);
+    }
 
-    void WriteHeader() {
-      m_OutputStream << "{\"otherData\": {}, \"traceEvents\":[{}";
-      m_OutputStream.flush();
+    inline TraceRingBuffer& threadBuffer(void) {
+      static thread_local TraceRingBuffer* t_Buffer = nullptr;
+      if (t_Buffer == nullptr) t_Buffer = registerThread();
+      return *t_Buffer;
     }
 
-    void WriteFooter() {
-      m_OutputStream << "]}";
-      m_OutputStream.flush();
+    // Allocate a ring buffer for the calling thread. Only happens once per thread.
+    TraceRingBuffer* registerThread(void);
+
+    void updateRecording(void) {
+      m_Recording.store((m_SessionActive.load() && m_OutputEnabled.load()) || m_LiveStats.load(),
+                        std::memory_order_relaxed);
     }
 
+    // Note: you must already own lock on m_Mutex for both of these.
+    void startFlusher(void);
+    void stopFlusher(std::unique_lock<std::mutex>& lock);
+    void flusherMain(void);
+    // Drain every thread's ring buffer into the trace writer and the stats.
+    // Note: you must already own lock on m_Mutex.
+    void drainBuffers(void);
+    void writeEvent(uint32_t threadIndex, const TraceEvent& event);
+
     // Note: you must already own lock on m_Mutex before
     // calling InternalEndSession()
-    void InternalEndSession() {
-      if (m_CurrentSession) {
-        WriteFooter();
-        m_OutputStream.close();
-        delete m_CurrentSession;
-        m_CurrentSession = nullptr;
-      }
-    }
+    void InternalEndSession();
 
    private:
+    // Guards the session, the encoder and the writer. Never taken on the hot path.
     std::mutex m_Mutex;
-    InstrumentationSession* m_CurrentSession;
-    std::ofstream m_OutputStream;
-    bool m_OutputEnabled = true;
+    std::string m_SessionName;
+    std::string m_SessionPath;
+    trace::Encoder m_Encoder;
+    TraceWriter m_Writer;
+
+    // Buffers are never freed, as the flusher might still be draining events
+    // that a thread wrote just before exiting.
+    std::mutex m_BuffersMutex;
+    std::vector<std::unique_ptr<TraceRingBuffer>> m_Buffers;
+
+    // Names of the tracks made by createTrack(), indexed from FIRST_TRACK_ID.
+    std::vector<const char*> m_Tracks;
+
+    std::thread m_Flusher;
+    std::condition_variable m_FlushCondition;
+    bool m_StopFlusher = false;
+
+    std::atomic<bool> m_SessionActive = false;
+    std::atomic<bool> m_OutputEnabled = true;
+    std::atomic<bool> m_LiveStats = false;
+    // (m_SessionActive && m_OutputEnabled) || m_LiveStats, so record() only does one load.
+    std::atomic<bool> m_Recording = false;
+
+    ProfileStats m_Stats;
   };
 
   class InstrumentationTimer {
@@ -161,7 +252,7 @@ namespace ren {
     InstrumentationTimer(const char* name)
         : m_Name(name)
         , m_Stopped(false) {
-      m_StartTimepoint = std::chrono::steady_clock::now();
+      m_Start = profileNow();
     }
 
     ~InstrumentationTimer() {
@@ -169,30 +260,30 @@ namespace ren {
     }
 
     void Stop() {
-      auto endTimepoint = std::chrono::steady_clock::now();
-      auto highResStart = FloatingPointMicroseconds{m_StartTimepoint.time_since_epoch()};
-      auto elapsedTime =
-          std::chrono::time_point_cast<std::chrono::microseconds>(endTimepoint).time_since_epoch() -
-          std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimepoint)
-              .time_since_epoch();
-
-      Instrumentor::Get().WriteProfile(
-          {m_Name, highResStart, elapsedTime, std::this_thread::get_id(), 'X'});
+      TraceEvent event;
+      event.name = m_Name;
+      event.timestamp = m_Start;
+      event.duration = profileNow() - m_Start;
+      event.type = TraceEventType::Complete;
+      Instrumentor::Get().record(event);
 
       m_Stopped = true;
     }
 
    private:
     const char* m_Name;
-    std::chrono::time_point<std::chrono::steady_clock> m_StartTimepoint;
+    uint64_t m_Start;
     bool m_Stopped;
   };
 
 
   static inline void emitInstrumentationMark(const char* name) {
-    Instrumentor::Get().WriteProfile(
-        {name, FloatingPointMicroseconds{std::chrono::steady_clock::now().time_since_epoch()},
-         std::chrono::microseconds(0), std::this_thread::get_id(), 'M'});
+    TraceEvent event;
+    event.name = name;
+    event.timestamp = profileNow();
+    event.duration = 0;
+    event.type = TraceEventType::Instant;
+    Instrumentor::Get().record(event);
   }
 
   namespace InstrumentorUtils {
@@ -253,13 +344,14 @@ namespace ren {
     ::ren::Instrumentor::Get().BeginSession(name, filepath)
   #define REN_PROFILE_END_SESSION() ::ren::Instrumentor::Get().EndSession()
   #define REN_PROFILE_SCOPE_LINE2(name, line)                            \
-    constexpr auto fixedName##line =                                     \
+    static constexpr auto fixedName##line =                              \
         ::ren::InstrumentorUtils::CleanupOutputString(name, "__cdecl "); \
     ::ren::InstrumentationTimer timer##line(fixedName##line.Data)
   #define REN_PROFILE_SCOPE_LINE(name, line) REN_PROFILE_SCOPE_LINE2(name, line)
   #define REN_PROFILE_SCOPE(name) REN_PROFILE_SCOPE_LINE(name, __LINE__)
   #define REN_PROFILE_FUNCTION() REN_PROFILE_SCOPE(REN_FUNC_SIG)
   #define REN_PROFILE_MARK(name) ::ren::emitInstrumentationMark(name)
+  #define REN_PROFILE_FRAME() ::ren::Instrumentor::Get().markFrame()
   #define REN_PROFILE_OUTPUT(enable) ::ren::Instrumentor::Get().enableOutput(enable)
   #define REN_PROFILE_OUTPUT_ENABLED() ::ren::Instrumentor::Get().isOutputEnabled()
   #define REN_PROFILE_COUNTER(name, value) ::ren::Instrumentor::Get().writeCounter(name, value)
@@ -269,6 +361,7 @@ namespace ren {
   #define REN_PROFILE_SCOPE(name)
   #define REN_PROFILE_FUNCTION()
   #define REN_PROFILE_MARK(name)
+  #define REN_PROFILE_FRAME()
   #define REN_PROFILE_OUTPUT(enable)
   #define REN_PROFILE_OUTPUT_ENABLED() (false)
   #define REN_PROFILE_COUNTER(name, value)
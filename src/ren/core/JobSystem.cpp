@@ -0,0 +1,209 @@
+#include <ren/core/JobSystem.h>
+#include <ren/core/Instrumentation.h>
+
+namespace ren {
+
+  static JobSystem *g_jobSystem = nullptr;
+  static thread_local u32 t_ThreadIndex = UINT32_MAX;
+
+  JobSystem &JobSystem::get(void) {
+    if (g_jobSystem == nullptr) { throw std::runtime_error("JobSystem not initialized"); }
+    return *g_jobSystem;
+  }
+
+
+  u32 JobSystem::getThreadIndex(void) { return t_ThreadIndex; }
+
+
+  // ---- JobCounter ---- //
+
+  void JobCounter::increment(void) {
+    std::lock_guard lock(mutex);
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+
+
+  std::vector<Job> JobCounter::decrement(void) {
+    std::vector<Job> ready;
+    std::lock_guard lock(mutex);
+    if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) ready.swap(continuations);
+    return ready;
+  }
+
+
+  // ---- JobSystem ---- //
+
+  JobSystem::JobSystem(u32 workerCount) {
+    g_jobSystem = this;
+    // Whoever creates the job system is the main thread.
+    t_ThreadIndex = 0;
+
+    if (workerCount == 0) workerCount = std::max<u32>(std::thread::hardware_concurrency(), 2) - 1;
+
+    for (u32 i = 0; i <= workerCount; i++) {
+      queues.push_back(std::make_unique<Queue>());
+    }
+    for (u32 i = 1; i <= workerCount; i++) {
+      workers.emplace_back(&JobSystem::workerMain, this, i);
+    }
+    fmt::println("Job system started with {} workers", workerCount);
+  }
+
+
+  JobSystem::~JobSystem(void) {
+    // Jobs that are still queued are dropped. Wait on their counters first if they matter.
+    {
+      std::lock_guard lock(sleepMutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    if (g_jobSystem == this) g_jobSystem = nullptr;
+  }
+
+
+  Job JobSystem::track(Job job, JobCounter *counter) {
+    if (counter == nullptr) return job;
+    counter->increment();
+    return [this, job = std::move(job), counter] {
+      job();
+      for (auto &continuation : counter->decrement()) {
+        push(std::move(continuation));
+      }
+    };
+  }
+
+
+  void JobSystem::run(Job job, JobCounter *counter) { push(track(std::move(job), counter)); }
+
+
+  void JobSystem::runAfter(JobCounter &dependency, Job job, JobCounter *counter) {
+    Job wrapped = track(std::move(job), counter);
+
+    {
+      std::lock_guard lock(dependency.mutex);
+      if (!dependency.done()) {
+        dependency.continuations.push_back(std::move(wrapped));
+        return;
+      }
+    }
+    push(std::move(wrapped));
+  }
+
+
+  void JobSystem::runOnMainThread(Job job, JobCounter *counter) {
+    Job wrapped = track(std::move(job), counter);
+
+    std::lock_guard lock(mainMutex);
+    mainJobs.push_back(std::move(wrapped));
+  }
+
+
+  void JobSystem::pumpMainThread(void) {
+    if (!isMainThread()) throw std::runtime_error("pumpMainThread() called off the main thread");
+
+    std::vector<Job> jobs;
+    {
+      std::lock_guard lock(mainMutex);
+      jobs.swap(mainJobs);
+    }
+    for (auto &job : jobs) {
+      execute(job);
+    }
+  }
+
+
+  void JobSystem::wait(JobCounter &counter) {
+    REN_PROFILE_FUNCTION();
+    u32 index = getThreadIndex();
+    while (!counter.done()) {
+      // Main thread jobs could be what we're waiting on.
+      if (index == 0) pumpMainThread();
+      if (!runOne(index)) std::this_thread::yield();
+    }
+    // The job that finished the counter may still be inside decrement(), so
+    // take the lock once before letting the caller destroy the counter.
+    std::lock_guard lock(counter.mutex);
+  }
+
+
+  void JobSystem::push(Job job) {
+    u32 index = getThreadIndex();
+    if (index >= queues.size()) {
+      // Not one of ours, so hand it to a worker.
+      index = 1 + nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    }
+
+    // Count it before it's visible, so a thief can never take pending below zero.
+    pending.fetch_add(1, std::memory_order_release);
+    {
+      std::lock_guard lock(queues[index]->mutex);
+      queues[index]->jobs.push_back(std::move(job));
+    }
+
+    // Taking the lock means a worker can't miss the wakeup between checking
+    // `pending` and going to sleep.
+    { std::lock_guard lock(sleepMutex); }
+    wake.notify_one();
+  }
+
+
+  bool JobSystem::pop(u32 index, Job &job) {
+    if (index >= queues.size()) return false;
+    auto &queue = *queues[index];
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty()) return false;
+    job = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+  }
+
+
+  bool JobSystem::steal(u32 thief, Job &job) {
+    u32 count = static_cast<u32>(queues.size());
+    // Start just past ourselves so thieves don't all pile onto queue 0.
+    u32 start = thief < count ? thief + 1 : 0;
+    for (u32 i = 0; i < count; i++) {
+      u32 victim = (start + i) % count;
+      if (victim == thief) continue;
+      auto &queue = *queues[victim];
+      std::lock_guard lock(queue.mutex);
+      if (queue.jobs.empty()) continue;
+      job = std::move(queue.jobs.front());
+      queue.jobs.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+
+  bool JobSystem::runOne(u32 index) {
+    Job job;
+    if (!pop(index, job) && !steal(index, job)) return false;
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    execute(job);
+    return true;
+  }
+
+
+  void JobSystem::execute(Job &job) {
+    REN_PROFILE_SCOPE("Job");
+    job();
+  }
+
+
+  void JobSystem::workerMain(u32 index) {
+    t_ThreadIndex = index;
+
+    while (true) {
+      if (runOne(index)) continue;
+
+      std::unique_lock lock(sleepMutex);
+      wake.wait(lock, [&] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+      if (stopping) return;
+    }
+  }
+
+}  // namespace ren
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <ren/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ren {
+
+  using Job = std::function<void()>;
+
+
+  // Counts jobs that haven't finished yet. Pass one to JobSystem::run() to
+  // wait on a group of jobs, or to runAfter() to make jobs depend on them.
+  // A counter must outlive the jobs it counts (wait on it before it goes away).
+  class JobCounter {
+   public:
+    JobCounter(void) = default;
+    ~JobCounter(void) = default;
+
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool done(void) const { return count.load(std::memory_order_acquire) == 0; }
+
+   private:
+    friend class JobSystem;
+
+    void increment(void);
+    // Returns the continuations to schedule if this was the last job.
+    std::vector<Job> decrement(void);
+
+    std::atomic<u32> count = 0;
+    std::mutex mutex;
+    // Jobs waiting (via runAfter) for this counter to reach zero.
+    std::vector<Job> continuations;
+  };
+
+
+  // A pool of worker threads with one deque of jobs each. A thread pushes and
+  // pops its own jobs from the back (so recently queued, cache-warm work runs
+  // first), and idle threads steal from the front of everyone else's. The
+  // main thread has a deque too, and helps out whenever it waits on a counter.
+  //
+  // Some things (SDL, mostly) must only be touched from the main thread. Those
+  // go through runOnMainThread(), and run the next time the main thread calls
+  // pumpMainThread() or waits.
+  class JobSystem {
+   public:
+    // 0 workers means one per hardware thread, minus the main thread.
+    JobSystem(u32 workerCount = 0);
+    ~JobSystem(void);
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    static JobSystem &get(void);
+
+    // Queue `job` on any thread. `counter` (if given) is incremented now and
+    // decremented when the job has finished.
+    void run(Job job, JobCounter *counter = nullptr);
+    // Queue `job` once `dependency` reaches zero (right away if it already has).
+    void runAfter(JobCounter &dependency, Job job, JobCounter *counter = nullptr);
+    // Queue `job` to run on the main thread.
+    void runOnMainThread(Job job, JobCounter *counter = nullptr);
+
+    // Run every job queued for the main thread. Must be called from the main thread.
+    void pumpMainThread(void);
+
+    // Block until `counter` reaches zero, running other jobs in the meantime.
+    void wait(JobCounter &counter);
+
+    // Split [begin, end) into chunks of `grain` and call fn(chunkBegin, chunkEnd)
+    // for each of them in parallel. Returns once every chunk is done.
+    template <typename F>
+    void parallelFor(u32 begin, u32 end, u32 grain, F &&fn) {
+      if (end <= begin) return;
+      grain = std::max<u32>(grain, 1);
+
+      JobCounter counter;
+      for (u32 start = begin; start < end;) {
+        u32 stop = start + std::min(grain, end - start);
+        run([&fn, start, stop] { fn(start, stop); }, &counter);
+        start = stop;
+      }
+      wait(counter);
+    }
+
+    // Same as above, with a grain that gives each thread a few chunks to balance with.
+    template <typename F>
+    void parallelFor(u32 begin, u32 end, F &&fn) {
+      u32 chunks = getThreadCount() * 4;
+      parallelFor(begin, end, (end - begin + chunks - 1) / chunks, std::forward<F>(fn));
+    }
+
+    // Workers plus the main thread.
+    u32 getThreadCount(void) const { return static_cast<u32>(queues.size()); }
+    // 0 is the main thread, 1..N are the workers, UINT32_MAX is any other thread.
+    static u32 getThreadIndex(void);
+    static bool isMainThread(void) { return getThreadIndex() == 0; }
+
+   private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Job> jobs;
+    };
+
+    void workerMain(u32 index);
+    // Count `job` against `counter` (if there is one). The returned job counts
+    // it back down when it finishes, and queues whatever was waiting on it.
+    Job track(Job job, JobCounter *counter);
+    void push(Job job);
+    // Run one job if there is one. Returns false if every deque was empty.
+    bool runOne(u32 index);
+    bool pop(u32 index, Job &job);
+    bool steal(u32 thief, Job &job);
+    void execute(Job &job);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    // Where jobs queued from threads outside the pool go, round robin.
+    std::atomic<u32> nextQueue = 0;
+
+    // Sleeping workers wait for pending to become non-zero.
+    std::atomic<u32> pending = 0;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    std::mutex mainMutex;
+    std::vector<Job> mainJobs;
+  };
+
+}  // namespace ren
@@ -0,0 +1,190 @@
+#include <ren/core/ProfileStats.h>
+#include <ren/core/Instrumentation.h>
+
+namespace ren {
+
+  // A runaway loop of scopes shouldn't grow the flame graph without bound.
+  static constexpr size_t MAX_FRAME_EVENTS = 1 << 16;
+
+
+  void ProfileStats::setWindow(uint32_t frames) {
+    std::lock_guard lock(m_Mutex);
+    m_Window = std::max<uint32_t>(frames, 1);
+    m_Head = 0;
+    m_Frames = 0;
+    m_GpuHead = 0;
+    m_GpuFrames = 0;
+    for (auto& [name, scope] : m_Scopes) {
+      scope.times.assign(m_Window, 0);
+      scope.calls.assign(m_Window, 0);
+    }
+  }
+
+
+  uint32_t ProfileStats::getWindow(void) {
+    std::lock_guard lock(m_Mutex);
+    return m_Window;
+  }
+
+
+  void ProfileStats::add(uint32_t thread, const TraceEvent& event) {
+    if (event.type != TraceEventType::Complete) return;
+
+    std::lock_guard lock(m_Mutex);
+    auto [it, inserted] = m_Scopes.try_emplace(event.name);
+    auto& scope = it->second;
+    if (inserted) {
+      scope.gpu = event.track != 0;
+      scope.times.assign(m_Window, 0);
+      scope.calls.assign(m_Window, 0);
+    }
+
+    uint32_t slot = findFrame(event.timestamp);
+    if (scope.gpu) {
+      scope.frameTime[0] += event.duration;
+      scope.frameCalls[0]++;
+    } else if (slot != UINT32_MAX) {
+      // Anything older than every open frame is too late to count.
+      scope.frameTime[slot] += event.duration;
+      scope.frameCalls[slot]++;
+    }
+
+    if (slot == UINT32_MAX) return;
+    auto& events = m_OpenFrames[slot].events;
+    if (events.size() < MAX_FRAME_EVENTS) {
+      uint32_t lane = event.track != 0 ? event.track : thread;
+      events.push_back({event.name, lane, event.timestamp, event.duration});
+    }
+  }
+
+
+  void ProfileStats::endFrame(uint64_t timestamp) {
+    std::lock_guard lock(m_Mutex);
+    m_OpenFrames[m_Frame % OPEN_FRAMES].end = timestamp;
+    // The new frame reuses the oldest one's slot.
+    if (m_OpenCount == OPEN_FRAMES) {
+      closeFrame();
+    } else {
+      m_OpenCount++;
+    }
+
+    m_Frame++;
+    auto& frame = m_OpenFrames[m_Frame % OPEN_FRAMES];
+    frame.start = timestamp;
+    frame.end = UINT64_MAX;
+    frame.events.clear();
+  }
+
+
+  void ProfileStats::endGpuFrame(void) {
+    std::lock_guard lock(m_Mutex);
+    for (auto& [name, scope] : m_Scopes) {
+      if (!scope.gpu) continue;
+      scope.times[m_GpuHead] = scope.frameTime[0];
+      scope.calls[m_GpuHead] = scope.frameCalls[0];
+      scope.frameTime[0] = 0;
+      scope.frameCalls[0] = 0;
+    }
+    m_GpuHead = (m_GpuHead + 1) % m_Window;
+    m_GpuFrames = std::min(m_GpuFrames + 1, m_Window);
+  }
+
+
+  uint32_t ProfileStats::findFrame(uint64_t timestamp) const {
+    // Newest first: the first frame that started at or before `timestamp` has it.
+    for (uint32_t i = 0; i < m_OpenCount; i++) {
+      auto slot = static_cast<uint32_t>((m_Frame - i) % OPEN_FRAMES);
+      if (timestamp >= m_OpenFrames[slot].start) return slot;
+    }
+    return UINT32_MAX;
+  }
+
+
+  void ProfileStats::closeFrame(void) {
+    auto slot = static_cast<uint32_t>((m_Frame + 1 - m_OpenCount) % OPEN_FRAMES);
+    for (auto& [name, scope] : m_Scopes) {
+      if (scope.gpu) continue;
+      scope.times[m_Head] = scope.frameTime[slot];
+      scope.calls[m_Head] = scope.frameCalls[slot];
+      scope.frameTime[slot] = 0;
+      scope.frameCalls[slot] = 0;
+    }
+    m_Head = (m_Head + 1) % m_Window;
+    m_Frames = std::min(m_Frames + 1, m_Window);
+
+    auto& frame = m_OpenFrames[slot];
+    std::swap(m_LastEvents, frame.events);
+    m_LastStart = frame.start;
+    m_LastEnd = frame.end;
+    // endFrame hands the slot straight to the new frame, so m_OpenCount stays put.
+  }
+
+
+  void ProfileStats::snapshot(std::vector<ScopeStats>& scopes) {
+    scopes.clear();
+
+    std::lock_guard lock(m_Mutex);
+    std::vector<uint64_t> sorted;
+    for (auto& [name, scope] : m_Scopes) {
+      uint32_t frames = scope.gpu ? m_GpuFrames : m_Frames;
+      if (frames == 0) continue;
+      // The ring is filled from slot 0, so until it wraps the live frames are [0, frames).
+      sorted.assign(scope.times.begin(), scope.times.begin() + frames);
+      std::sort(sorted.begin(), sorted.end());
+
+      uint64_t totalTime = 0;
+      uint64_t totalCalls = 0;
+      for (uint32_t i = 0; i < frames; i++) {
+        totalTime += scope.times[i];
+        totalCalls += scope.calls[i];
+      }
+      if (totalCalls == 0) continue;  // Hasn't run in the whole window.
+
+      auto percentile = [&](double p) { return sorted[static_cast<size_t>(p * (frames - 1))]; };
+
+      ScopeStats stats;
+      stats.name = name;
+      stats.gpu = scope.gpu;
+      stats.callsPerFrame = static_cast<double>(totalCalls) / frames;
+      stats.mean = totalTime / frames;
+      stats.p50 = percentile(0.50);
+      stats.p95 = percentile(0.95);
+      stats.p99 = percentile(0.99);
+      stats.max = sorted.back();
+      scopes.push_back(stats);
+    }
+  }
+
+
+  uint64_t ProfileStats::lastFrame(std::vector<FlameEntry>& entries) {
+    entries.clear();
+
+    std::lock_guard lock(m_Mutex);
+    entries.reserve(m_LastEvents.size());
+    for (auto& event : m_LastEvents) {
+      entries.push_back({event.name, event.thread, 0, event.start - m_LastStart, event.duration});
+    }
+
+    // Scopes on a thread are properly nested, so after sorting by start (and
+    // longest first on ties) the depth is just how many open scopes contain it.
+    std::sort(entries.begin(), entries.end(), [](const FlameEntry& a, const FlameEntry& b) {
+      if (a.thread != b.thread) return a.thread < b.thread;
+      if (a.start != b.start) return a.start < b.start;
+      return a.duration > b.duration;
+    });
+    std::vector<uint64_t> openEnds;
+    uint32_t thread = UINT32_MAX;
+    for (auto& entry : entries) {
+      if (entry.thread != thread) {
+        thread = entry.thread;
+        openEnds.clear();
+      }
+      while (!openEnds.empty() && openEnds.back() <= entry.start) openEnds.pop_back();
+      entry.depth = static_cast<uint32_t>(openEnds.size());
+      openEnds.push_back(entry.start + entry.duration);
+    }
+
+    return m_LastEnd - m_LastStart;
+  }
+
+}  // namespace ren
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ren {
+
+  struct TraceEvent;
+
+  // Rolling statistics for one profile scope, over the last N frames. The
+  // times are how long the scope took *per frame* (all of its calls summed),
+  // since that's what adds up to a slow frame.
+  struct ScopeStats {
+    const char* name;
+    bool gpu;               // Came from a GPU zone rather than a CPU scope.
+    double callsPerFrame;   // Mean number of calls per frame.
+    uint64_t mean;          // ns
+    uint64_t p50, p95, p99;  // ns
+    uint64_t max;           // ns
+  };
+
+  // One scope from the last completed frame, for drawing a flame graph.
+  struct FlameEntry {
+    const char* name;
+    uint32_t thread;
+    uint32_t depth;
+    uint64_t start;     // ns from the start of the frame
+    uint64_t duration;  // ns
+  };
+
+
+  // Aggregates the trace events the Instrumentor drains into per-scope stats.
+  // Events are fed in on the flusher thread, and snapshots are taken from the
+  // UI thread, so everything public is guarded by a mutex.
+  //
+  // The flusher drains one thread at a time, so a worker's scopes can turn up
+  // after the main thread's next frame mark, and GPU zones only arrive once
+  // their frame has finished on the GPU. So CPU scopes are put in the frame
+  // their timestamp falls in, and frames are held open for a few marks before
+  // they're counted. GPU zones are counted per GPU frame instead (see
+  // endGpuFrame), and only use the open frames to place them in the flame graph.
+  class ProfileStats {
+   public:
+    static constexpr uint32_t DEFAULT_WINDOW = 240;
+    // How many frames are held open, including the one in progress. Enough for
+    // a GPU zone to be read back with every frame in flight still queued.
+    static constexpr uint32_t OPEN_FRAMES = 6;
+
+    ProfileStats(uint32_t window = DEFAULT_WINDOW) { setWindow(window); }
+
+    // How many frames of history to keep. Clears the current history.
+    void setWindow(uint32_t frames);
+    uint32_t getWindow(void);
+
+    void add(uint32_t thread, const TraceEvent& event);
+    // Called when a frame mark is drained. Starts a new frame at `timestamp`,
+    // and closes out the oldest open one if there's no room left.
+    void endFrame(uint64_t timestamp);
+    // Called when a GPU frame mark is drained. GpuQueryPool::collect records
+    // a frame's zones all at once, followed by the mark, so everything on the
+    // GPU since the last mark is the frame that just finished.
+    void endGpuFrame(void);
+
+    void snapshot(std::vector<ScopeStats>& scopes);
+    // The last completed frame's scopes, sorted by thread then start time.
+    // Returns the length of that frame in ns.
+    uint64_t lastFrame(std::vector<FlameEntry>& entries);
+
+   private:
+    struct Scope {
+      bool gpu = false;
+      // Accumulated for each open frame, indexed by frame % OPEN_FRAMES. GPU
+      // scopes only use slot 0, for the GPU frame being collected.
+      std::array<uint64_t, OPEN_FRAMES> frameTime{};
+      std::array<uint32_t, OPEN_FRAMES> frameCalls{};
+      // Per-frame history, as a ring of m_Window entries.
+      std::vector<uint64_t> times;
+      std::vector<uint32_t> calls;
+    };
+
+    struct PendingEvent {
+      const char* name;
+      uint32_t thread;
+      uint64_t start;
+      uint64_t duration;
+    };
+
+    // The span between two frame marks, and the scopes that ran in it.
+    struct OpenFrame {
+      uint64_t start = 0;
+      uint64_t end = UINT64_MAX;  // Until the next frame mark.
+      std::vector<PendingEvent> events;
+    };
+
+    // Which open frame `timestamp` falls in, or UINT32_MAX if it's older than all of them.
+    uint32_t findFrame(uint64_t timestamp) const;
+    // Fold the oldest open frame into the history. Must own m_Mutex.
+    void closeFrame(void);
+
+    std::mutex m_Mutex;
+    uint32_t m_Window = 0;
+    uint32_t m_Head = 0;   // Next slot to write in each CPU scope's ring.
+    uint32_t m_Frames = 0;  // How many slots hold real data (<= m_Window).
+    // The same again for GPU scopes, which advance once per GPU frame.
+    uint32_t m_GpuHead = 0;
+    uint32_t m_GpuFrames = 0;
+    std::unordered_map<const char*, Scope> m_Scopes;
+
+    // Frames (m_Frame - m_OpenCount, m_Frame] are open, indexed by frame % OPEN_FRAMES.
+    uint64_t m_Frame = 0;
+    uint32_t m_OpenCount = 1;
+    std::array<OpenFrame, OPEN_FRAMES> m_OpenFrames;
+    std::vector<PendingEvent> m_LastEvents;
+    uint64_t m_LastStart = 0;
+    uint64_t m_LastEnd = 0;
+  };
+
+}  // namespace ren
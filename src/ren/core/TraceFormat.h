@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The binary trace format written by the Instrumentor (*.rtrace). It is a
+// flat stream of records, so a session that is cut short (crash, kill) is
+// still readable up to the last complete record. Use `ren-trace` to convert
+// it to Chrome/Perfetto JSON.
+//
+//   header:  "RENTRACE" u32:version
+//   record:  u8:tag, then tag-specific fields
+//
+// All integers are LEB128 varints unless noted. Names are interned: a Name
+// record defines an id once, and events refer to it. Timestamps are stored
+// as a zigzag-encoded delta from the previous event *on the same thread*,
+// since consecutive events of one thread are close together in time.
+
+namespace ren::trace {
+
+  constexpr char MAGIC[8] = {'R', 'E', 'N', 'T', 'R', 'A', 'C', 'E'};
+  constexpr uint32_t VERSION = 1;
+
+  enum Tag : uint8_t {
+    // varint:id varint:length bytes:name
+    TAG_NAME = 1,
+    // varint:thread varint:name varint:delta_ts varint:duration
+    TAG_COMPLETE = 2,
+    // varint:thread varint:name varint:delta_ts
+    TAG_INSTANT = 3,
+    // varint:thread varint:name varint:delta_ts f64:value
+    TAG_COUNTER = 4,
+    // varint:thread varint:name
+    // Names a thread. Used for tracks that aren't CPU threads, like the GPU.
+    TAG_TRACK = 5,
+  };
+
+
+  inline void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<uint8_t>(value) | 0x80);
+      value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+  }
+
+  inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+  }
+
+  inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  inline void writeF64(std::vector<uint8_t> &out, double value) {
+    uint8_t bytes[sizeof(double)];
+    memcpy(bytes, &value, sizeof(double));
+    out.insert(out.end(), bytes, bytes + sizeof(double));
+  }
+
+
+  // Turns events into records. Keeps the per-thread timestamps and the name
+  // table, so there should be exactly one encoder per output stream.
+  class Encoder {
+   public:
+    void writeHeader(std::vector<uint8_t> &out) {
+      out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+      for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(VERSION >> (i * 8)));
+      }
+    }
+
+    void writeComplete(std::vector<uint8_t> &out, uint32_t thread, const char *name,
+                       uint64_t timestamp, uint64_t duration) {
+      writeEventPrefix(out, TAG_COMPLETE, thread, name, timestamp);
+      writeVarint(out, duration);
+    }
+
+    void writeInstant(std::vector<uint8_t> &out, uint32_t thread, const char *name,
+                      uint64_t timestamp) {
+      writeEventPrefix(out, TAG_INSTANT, thread, name, timestamp);
+    }
+
+    void writeCounter(std::vector<uint8_t> &out, uint32_t thread, const char *name,
+                      uint64_t timestamp, double value) {
+      writeEventPrefix(out, TAG_COUNTER, thread, name, timestamp);
+      writeF64(out, value);
+    }
+
+    void writeTrack(std::vector<uint8_t> &out, uint32_t thread, const char *name) {
+      uint64_t nameId = internName(out, name);
+      out.push_back(TAG_TRACK);
+      writeVarint(out, thread);
+      writeVarint(out, nameId);
+    }
+
+   private:
+    void writeEventPrefix(std::vector<uint8_t> &out, Tag tag, uint32_t thread, const char *name,
+                          uint64_t timestamp) {
+      // The name record has to come first, so the reader knows the id.
+      uint64_t nameId = internName(out, name);
+
+      if (thread >= lastTimestamps.size()) lastTimestamps.resize(thread + 1, 0);
+      int64_t delta = static_cast<int64_t>(timestamp - lastTimestamps[thread]);
+      lastTimestamps[thread] = timestamp;
+
+      out.push_back(tag);
+      writeVarint(out, thread);
+      writeVarint(out, nameId);
+      writeVarint(out, zigzagEncode(delta));
+    }
+
+    uint64_t internName(std::vector<uint8_t> &out, const char *name) {
+      // Most names are string literals, so the pointer is a cheap first lookup.
+      auto it = namesByPointer.find(name);
+      if (it != namesByPointer.end()) return it->second;
+
+      // The same string can live at more than one address (one per translation unit).
+      std::string str(name);
+      auto strIt = namesByString.find(str);
+      if (strIt != namesByString.end()) {
+        namesByPointer[name] = strIt->second;
+        return strIt->second;
+      }
+
+      uint64_t id = namesByString.size();
+      namesByString[str] = id;
+      namesByPointer[name] = id;
+
+      out.push_back(TAG_NAME);
+      writeVarint(out, id);
+      writeVarint(out, str.size());
+      out.insert(out.end(), str.begin(), str.end());
+      return id;
+    }
+
+    std::unordered_map<const char *, uint64_t> namesByPointer;
+    std::unordered_map<std::string, uint64_t> namesByString;
+    std::vector<uint64_t> lastTimestamps;
+  };
+
+
+  // A decoded event, as produced by the Decoder.
+  struct Event {
+    Tag tag;
+    uint32_t thread;
+    uint64_t name;
+    uint64_t timestamp;
+    uint64_t duration = 0;
+    double value = 0.0;
+  };
+
+
+  // Reads records back out of a buffer. Name records are consumed internally
+  // and exposed through getName().
+  class Decoder {
+   public:
+    Decoder(const uint8_t *data, size_t size)
+        : data(data)
+        , size(size) {}
+
+    bool readHeader(void) {
+      if (size < sizeof(MAGIC) + 4 || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) return false;
+      uint32_t version = 0;
+      for (int i = 0; i < 4; i++) {
+        version |= static_cast<uint32_t>(data[sizeof(MAGIC) + i]) << (i * 8);
+      }
+      pos = sizeof(MAGIC) + 4;
+      return version == VERSION;
+    }
+
+    // Returns false at the end of the stream, or at the first incomplete
+    // record if the file was truncated.
+    bool next(Event &event) {
+      while (pos < size) {
+        size_t start = pos;
+        uint8_t tag = data[pos++];
+
+        if (tag == TAG_NAME) {
+          uint64_t id, length;
+          if (!readVarint(id) || !readVarint(length) || pos + length > size) {
+            pos = start;
+            return false;
+          }
+          if (id >= names.size()) names.resize(id + 1);
+          names[id].assign(reinterpret_cast<const char *>(data + pos), length);
+          pos += length;
+          continue;
+        }
+
+        if (tag == TAG_TRACK) {
+          uint64_t thread, name;
+          if (!readVarint(thread) || !readVarint(name)) {
+            pos = start;
+            return false;
+          }
+          event = Event{};
+          event.tag = TAG_TRACK;
+          event.thread = static_cast<uint32_t>(thread);
+          event.name = name;
+          return true;
+        }
+
+        uint64_t thread, name, delta;
+        if (!readVarint(thread) || !readVarint(name) || !readVarint(delta)) {
+          pos = start;
+          return false;
+        }
+        if (thread >= lastTimestamps.size()) lastTimestamps.resize(thread + 1, 0);
+        lastTimestamps[thread] += zigzagDecode(delta);
+
+        event = Event{};
+        event.tag = static_cast<Tag>(tag);
+        event.thread = static_cast<uint32_t>(thread);
+        event.name = name;
+        event.timestamp = lastTimestamps[thread];
+
+        switch (tag) {
+          case TAG_COMPLETE:
+            if (readVarint(event.duration)) return true;
+            break;
+          case TAG_INSTANT: return true;
+          case TAG_COUNTER:
+            if (pos + sizeof(double) > size) break;
+            memcpy(&event.value, data + pos, sizeof(double));
+            pos += sizeof(double);
+            return true;
+          default:
+            // Unknown record. We can't know how long it is, so stop here.
+            break;
+        }
+        pos = start;
+        return false;
+      }
+      return false;
+    }
+
+    const std::string &getName(uint64_t id) const {
+      static const std::string unknown = "<unknown>";
+      return id < names.size() ? names[id] : unknown;
+    }
+
+    size_t getOffset(void) const { return pos; }
+
+   private:
+    bool readVarint(uint64_t &value) {
+      value = 0;
+      for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) return false;
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+      }
+      return false;
+    }
+
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+    std::vector<std::string> names;
+    std::vector<uint64_t> lastTimestamps;
+  };
+
+}  // namespace ren::trace
@@ -0,0 +1,73 @@
+#include <ren/core/TraceWriter.h>
+
+namespace ren {
+
+  bool TraceWriter::open(const std::string &filepath) {
+    close();
+
+    file = fopen(filepath.c_str(), "wb");
+    if (file == nullptr) return false;
+
+    front.clear();
+    back.clear();
+    front.reserve(BUFFER_SIZE);
+    back.reserve(BUFFER_SIZE);
+
+    stop = false;
+    backPending = false;
+    ioThread = std::thread(&TraceWriter::ioMain, this);
+    return true;
+  }
+
+
+  void TraceWriter::close(void) {
+    if (file == nullptr) return;
+
+    commit(true);
+    {
+      std::lock_guard lock(mutex);
+      stop = true;
+    }
+    condition.notify_all();
+    ioThread.join();
+
+    fclose(file);
+    file = nullptr;
+  }
+
+
+  void TraceWriter::commit(bool force) {
+    if (front.empty()) return;
+    if (!force && front.size() < BUFFER_SIZE) return;
+
+    std::unique_lock lock(mutex);
+    // Wait for the IO thread to finish with the last buffer.
+    condition.wait(lock, [this] { return !backPending; });
+    std::swap(front, back);
+    front.clear();
+    backPending = true;
+    lock.unlock();
+    condition.notify_all();
+  }
+
+
+  void TraceWriter::ioMain(void) {
+    std::unique_lock lock(mutex);
+    while (true) {
+      condition.wait(lock, [this] { return backPending || stop; });
+      if (backPending) {
+        // The back buffer belongs to us until we clear backPending, so we
+        // don't need the lock while writing it.
+        lock.unlock();
+        fwrite(back.data(), 1, back.size(), file);
+        fflush(file);
+        lock.lock();
+        backPending = false;
+        condition.notify_all();
+      } else if (stop) {
+        break;
+      }
+    }
+  }
+
+}  // namespace ren
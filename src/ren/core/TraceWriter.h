@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ren {
+
+  // A double-buffered file writer. The caller appends into the front buffer,
+  // and once that fills up the buffers are swapped and a dedicated IO thread
+  // writes the back buffer to disk. The caller only ever blocks if it fills a
+  // whole buffer before the previous one has hit the disk.
+  class TraceWriter {
+   public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    TraceWriter() = default;
+    ~TraceWriter() { close(); }
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    bool open(const std::string &filepath);
+    void close(void);
+    bool isOpen(void) const { return file != nullptr; }
+
+    // The buffer to append to. Call commit() afterwards.
+    std::vector<uint8_t> &buffer(void) { return front; }
+    // Hand the front buffer to the IO thread if it is full enough (or if `force` is set).
+    void commit(bool force = false);
+
+   private:
+    void ioMain(void);
+
+    FILE *file = nullptr;
+    std::vector<uint8_t> front;
+    std::vector<uint8_t> back;
+
+    std::thread ioThread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool backPending = false;  // back buffer is waiting to be written
+    bool stop = false;
+  };
+
+}  // namespace ren
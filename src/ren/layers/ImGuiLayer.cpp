@@ -68,8 +68,12 @@ namespace ren {
     init_info.Device = vulkan.device;
     init_info.Queue = vulkan.graphics_queue;
     init_info.DescriptorPool = imguiPool;
-    init_info.MinImageCount = 3;
-    init_info.ImageCount = 3;
+    init_info.PipelineCache = vulkan.pipelineCache->getHandle();
+    // ImGui keeps a vertex buffer per "image", and cycles through them once a
+    // frame, so it needs as many as we have frames in flight (and at least 2).
+    u32 imageCount = std::max<u32>(Renderer::get().getFrameCount(), 2);
+    init_info.MinImageCount = imageCount;
+    init_info.ImageCount = imageCount;
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.RenderPass = Renderer::get().getRenderPass().getHandle();
 
@@ -136,6 +140,9 @@ namespace ren {
 
   void ImGuiLayer::onDetach(void) {
     REN_PROFILE_FUNCTION();
+    // Deferred texture deletions still need ImGui around to remove their IDs.
+    Renderer::get().waitForIdle();
+    DeletionQueue::get().flush();
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
@@ -23,6 +23,9 @@ namespace ren {
     virtual void onAttach(void) {}
     virtual void onDetach(void) {}
     virtual void onUpdate(float deltaTime) {}
+    // Record draws into the current frame (see ren::getFrameData()). The
+    // scene render pass is active.
+    virtual void onRender(void) {}
     virtual void onImguiRender(float deltaTime) {}
     virtual void onEvent(Event &event) {}
 
@@ -61,6 +61,12 @@ namespace ren {
         layer->onUpdate(deltaTime);
       }
     }
+    inline void onRender(void) {
+      REN_PROFILE_FUNCTION();
+      for (auto &layer : layers) {
+        layer->onRender();
+      }
+    }
     inline void onImGuiRender(float deltaTime) {
       REN_PROFILE_FUNCTION();
       for (auto &layer : layers) {
@@ -0,0 +1,331 @@
+#include <imgui.h>
+#include <cstring>
+#include <string_view>
+
+#include <ren/layers/ProfilerLayer.h>
+#include <ren/core/Instrumentation.h>
+#include <ren/renderer/GpuProfiler.h>
+#include <ren/renderer/Renderer.h>
+#include <ren/renderer/Vulkan.h>
+
+namespace ren {
+
+  static float toMillis(u64 ns) { return ns / 1000000.0f; }
+  static float toMegabytes(VkDeviceSize bytes) { return bytes / (1024.0f * 1024.0f); }
+
+
+  ProfilerLayer::ProfilerLayer(Application &app)
+      : Layer(app, "Profiler") {}
+
+
+  void ProfilerLayer::onAttach(void) { Instrumentor::Get().enableLiveStats(true); }
+
+
+  void ProfilerLayer::onDetach(void) { Instrumentor::Get().enableLiveStats(false); }
+
+
+  void ProfilerLayer::onUpdate(float deltaTime) {
+    framerate.addFrame(deltaTime);
+    framerate.emitCounters();
+  }
+
+
+  void ProfilerLayer::onImguiRender(float deltaTime) {
+    REN_PROFILE_FUNCTION();
+    auto &instrumentor = Instrumentor::Get();
+
+    ImGui::Begin("Profiler");
+
+    ImGui::Text("FPS: %.1f, frame %.2fms (GPU %.2fms)", framerate.getAverageFramerate(),
+                deltaTime * 1000.0f, toMillis(GpuProfiler::get().getLastFrameTime()));
+    ImGui::Text("Trace: %.2fMB, %llu events dropped",
+                instrumentor.profileBytes / (1024.0f * 1024.0f),
+                (unsigned long long)instrumentor.droppedEvents());
+
+    bool outputEnabled = REN_PROFILE_OUTPUT_ENABLED();
+    if (ImGui::Checkbox("Write Trace", &outputEnabled)) REN_PROFILE_OUTPUT(outputEnabled);
+
+    int window = instrumentor.getStats().getWindow();
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    if (ImGui::InputInt("Window (frames)", &window, 60, 600)) {
+      instrumentor.getStats().setWindow(std::clamp(window, 1, 10000));
+    }
+
+    if (ImGui::CollapsingHeader("Frame Times", ImGuiTreeNodeFlags_DefaultOpen)) drawFrameTimes();
+    if (ImGui::CollapsingHeader("Frame Pacing", ImGuiTreeNodeFlags_DefaultOpen)) drawPacing();
+    if (ImGui::CollapsingHeader("Memory")) drawMemory();
+    if (ImGui::CollapsingHeader("Last Frame", ImGuiTreeNodeFlags_DefaultOpen)) drawFlameGraph();
+    if (ImGui::CollapsingHeader("Scopes", ImGuiTreeNodeFlags_DefaultOpen)) drawScopeTable();
+
+    ImGui::End();
+  }
+
+
+  void ProfilerLayer::drawFrameTimes(void) {
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("frameTimes", 7, flags)) return;
+
+    ImGui::TableSetupColumn("Window");
+    ImGui::TableSetupColumn("Avg FPS");
+    ImGui::TableSetupColumn("1% Low");
+    ImGui::TableSetupColumn("0.1% Low");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("Stutters");
+    ImGui::TableHeadersRow();
+
+    for (auto &histogram : framerate.getHistograms()) {
+      float average = histogram.getAverageDeltaTime();
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%u frames", histogram.getWindow());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", average > 0.0f ? 1.0f / average : 0.0f);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", histogram.lowFramerate(0.01f));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", histogram.lowFramerate(0.001f));
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2fms", histogram.percentile(0.50f) * 1000.0f);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2fms", histogram.percentile(0.99f) * 1000.0f);
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", histogram.getStutters());
+    }
+
+    ImGui::EndTable();
+  }
+
+
+  void ProfilerLayer::drawPacing(void) {
+    auto &renderer = Renderer::get();
+    auto &limiter = renderer.getFrameLimiter();
+
+    const char *current = Swapchain::getPresentModeName(renderer.getPresentMode());
+    ImGui::SetNextItemWidth(160.0f);
+    if (ImGui::BeginCombo("Present Mode", current)) {
+      for (auto mode : Swapchain::PRESENT_MODES) {
+        bool selected = mode == renderer.getPresentMode();
+        if (ImGui::Selectable(Swapchain::getPresentModeName(mode), selected)) {
+          renderer.setPresentMode(mode);
+        }
+      }
+      ImGui::EndCombo();
+    }
+    if (renderer.getActivePresentMode() != renderer.getPresentMode()) {
+      ImGui::SameLine();
+      ImGui::Text("(using %s)", Swapchain::getPresentModeName(renderer.getActivePresentMode()));
+    }
+
+    ImGui::Checkbox("Low Latency", &limiter.lowLatency);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    if (ImGui::InputFloat("FPS Cap", &limiter.fpsCap, 10.0f, 60.0f, "%.0f")) {
+      limiter.fpsCap = std::max(limiter.fpsCap, 0.0f);
+    }
+
+    ImGui::Text("Latency %.2fms (CPU start to GPU done), %u frames in flight",
+                toMillis(limiter.getLatency()), renderer.getFrameCount());
+    ImGui::Text("Sleep %.2fms, stall %.2fms", toMillis(limiter.getSleep()),
+                toMillis(limiter.getStall()));
+  }
+
+
+  void ProfilerLayer::drawMemory(void) {
+    auto &vulkan = getVulkan();
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                            ImGuiTableFlags_SizingFixedFit;
+
+    // Everything VMA has allocated, per heap, against what the OS lets us have.
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkan.allocator, &memoryProperties);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+    vmaGetHeapBudgets(vulkan.allocator, budgets.data());
+
+    if (ImGui::BeginTable("heaps", 5, flags)) {
+      ImGui::TableSetupColumn("Heap");
+      ImGui::TableSetupColumn("Usage / Budget");
+      ImGui::TableSetupColumn("Blocks");
+      ImGui::TableSetupColumn("Allocations");
+      ImGui::TableSetupColumn("Allocated");
+      ImGui::TableHeadersRow();
+
+      for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        auto &budget = budgets[i];
+        bool deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%u (%s)", i, deviceLocal ? "device" : "host");
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f / %.1fMB", toMegabytes(budget.usage), toMegabytes(budget.budget));
+        ImGui::TableNextColumn();
+        ImGui::Text("%u (%.1fMB)", budget.statistics.blockCount,
+                    toMegabytes(budget.statistics.blockBytes));
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", budget.statistics.allocationCount);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1fMB", toMegabytes(budget.statistics.allocationBytes));
+      }
+      ImGui::EndTable();
+    }
+
+    // The buffer pools. What's left of the heaps above is images and buffers
+    // too big for a pool.
+    if (ImGui::BeginTable("pools", 6, flags)) {
+      ImGui::TableSetupColumn("Pool");
+      ImGui::TableSetupColumn("Memory Type");
+      ImGui::TableSetupColumn("Blocks");
+      ImGui::TableSetupColumn("Allocations");
+      ImGui::TableSetupColumn("Allocated");
+      ImGui::TableSetupColumn("Used");
+      ImGui::TableHeadersRow();
+
+      for (u32 i = 0; i < MemoryPools::CATEGORY_COUNT; i++) {
+        auto category = static_cast<MemoryCategory>(i);
+        VmaStatistics stats = vulkan.memory->getStatistics(category);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(MemoryPools::getCategoryName(category));
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", vulkan.memory->getMemoryTypeIndex(category));
+        ImGui::TableNextColumn();
+        ImGui::Text("%u x %.0fMB", stats.blockCount,
+                    toMegabytes(vulkan.memory->getBlockSize(category)));
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", stats.allocationCount);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2fMB", toMegabytes(stats.allocationBytes));
+        ImGui::TableNextColumn();
+        float used = stats.blockBytes > 0 ? float(stats.allocationBytes) / stats.blockBytes : 0.0f;
+        ImGui::Text("%.0f%%", used * 100.0f);
+      }
+      ImGui::EndTable();
+    }
+  }
+
+
+  void ProfilerLayer::drawScopeTable(void) {
+    enum Column { Name, Calls, Mean, P50, P95, P99, Max };
+
+    Instrumentor::Get().getStats().snapshot(scopes);
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable |
+                            ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("scopes", 7, flags, ImVec2(0.0f, 300.0f))) return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch, 0.0f, Name);
+    ImGui::TableSetupColumn("Calls", 0, 0.0f, Calls);
+    ImGui::TableSetupColumn("Mean", ImGuiTableColumnFlags_DefaultSort |
+                                        ImGuiTableColumnFlags_PreferSortDescending,
+                            0.0f, Mean);
+    ImGui::TableSetupColumn("p50", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, P50);
+    ImGui::TableSetupColumn("p95", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, P95);
+    ImGui::TableSetupColumn("p99", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, P99);
+    ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, Max);
+    ImGui::TableHeadersRow();
+
+    // We re-snapshot every frame, so sort every frame rather than only when the specs change.
+    if (auto *specs = ImGui::TableGetSortSpecs(); specs && specs->SpecsCount > 0) {
+      auto column = specs->Specs[0].ColumnUserID;
+      bool ascending = specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+      auto key = [column](const ScopeStats &s) -> double {
+        switch (column) {
+          case Calls: return s.callsPerFrame;
+          case Mean: return s.mean;
+          case P50: return s.p50;
+          case P95: return s.p95;
+          case P99: return s.p99;
+          case Max: return s.max;
+          default: return 0.0;
+        }
+      };
+      std::sort(scopes.begin(), scopes.end(), [&](const ScopeStats &a, const ScopeStats &b) {
+        if (column == Name) {
+          int cmp = strcmp(a.name, b.name);
+          return ascending ? cmp < 0 : cmp > 0;
+        }
+        return ascending ? key(a) < key(b) : key(a) > key(b);
+      });
+    }
+
+    for (auto &scope : scopes) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (scope.gpu) {
+        ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "[GPU] %s", scope.name);
+      } else {
+        ImGui::TextUnformatted(scope.name);
+      }
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", scope.callsPerFrame);
+      for (u64 value : {scope.mean, scope.p50, scope.p95, scope.p99, scope.max}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3fms", toMillis(value));
+      }
+    }
+
+    ImGui::EndTable();
+  }
+
+
+  void ProfilerLayer::drawFlameGraph(void) {
+    u64 frameLength = Instrumentor::Get().getStats().lastFrame(flame);
+    if (frameLength == 0 || flame.empty()) {
+      ImGui::TextUnformatted("No frames recorded yet.");
+      return;
+    }
+
+    // One band per thread (or track), with scopes stacked by nesting depth.
+    u32 maxDepth = 0;
+    u32 lanes = 1;
+    for (size_t i = 0; i < flame.size(); i++) {
+      maxDepth = std::max(maxDepth, flame[i].depth);
+      if (i > 0 && flame[i].thread != flame[i - 1].thread) lanes++;
+    }
+
+    float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    float laneGap = rowHeight * 0.5f;
+    float width = ImGui::GetContentRegionAvail().x;
+    float height = lanes * (maxDepth + 1) * rowHeight + (lanes - 1) * laneGap;
+    float scale = width / frameLength;
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton("flame", ImVec2(width, height));
+    bool hovered = ImGui::IsItemHovered();
+    ImVec2 mouse = ImGui::GetMousePos();
+    auto *draw = ImGui::GetWindowDrawList();
+
+    float laneTop = origin.y;
+    u32 thread = flame[0].thread;
+    for (auto &entry : flame) {
+      if (entry.thread != thread) {
+        thread = entry.thread;
+        laneTop += (maxDepth + 1) * rowHeight + laneGap;
+      }
+
+      float x0 = origin.x + entry.start * scale;
+      float x1 = origin.x + (entry.start + entry.duration) * scale;
+      if (x1 - x0 < 1.0f) continue;  // Too small to see, and too small to matter.
+      float y0 = laneTop + entry.depth * rowHeight;
+      float y1 = y0 + rowHeight - 1.0f;
+
+      // Color by name so the same scope is recognizable from frame to frame.
+      u32 hash = static_cast<u32>(std::hash<std::string_view>{}(entry.name));
+      ImU32 color = IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F),
+                             80 + ((hash >> 16) & 0x7F), 255);
+      draw->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), color);
+
+      ImVec4 clip(x0, y0, x1, y1);
+      draw->AddText(nullptr, 0.0f, ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32_BLACK, entry.name,
+                    nullptr, 0.0f, &clip);
+
+      if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+        ImGui::SetTooltip("%s\n%.3fms", entry.name, toMillis(entry.duration));
+      }
+    }
+  }
+}  // namespace ren
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <ren/types.h>
+#include <ren/layers/Layer.h>
+#include <ren/core/ProfileStats.h>
+#include <ren/core/FramerateCounter.h>
+
+namespace ren {
+
+  // An ImGui panel showing the Instrumentor's live per-scope statistics, and
+  // a flame graph of the last frame. Enables live stats while attached. It
+  // also has the frame pacing controls: present mode and frame limiter, and
+  // a view of GPU memory: heap budgets and the buffer pools.
+  class ProfilerLayer : public Layer {
+   public:
+    ProfilerLayer(Application &app);
+    ~ProfilerLayer() override = default;
+
+    void onAttach(void) override;
+    void onDetach(void) override;
+    void onUpdate(float deltaTime) override;
+    void onImguiRender(float deltaTime) override;
+
+   private:
+    void drawFrameTimes(void);
+    void drawPacing(void);
+    void drawMemory(void);
+    void drawScopeTable(void);
+    void drawFlameGraph(void);
+
+    FramerateCounter framerate;
+
+    // Reused between frames to avoid reallocating.
+    std::vector<ScopeStats> scopes;
+    std::vector<FlameEntry> flame;
+  };
+}  // namespace ren
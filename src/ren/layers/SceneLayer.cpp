@@ -0,0 +1,180 @@
+#include <ren/layers/SceneLayer.h>
+#include <ren/core/Application.h>
+#include <ren/core/Instrumentation.h>
+#include <ren/renderer/Renderer.h>
+#include <ren/renderer/GpuProfiler.h>
+#include <ren/core/JobSystem.h>
+
+namespace ren {
+
+  static void generateSphere(std::vector<Vertex> &vertices, std::vector<u32> &indices,
+                             float radius, u32 segments, u32 rings) {
+    REN_PROFILE_FUNCTION();
+    vertices.clear();
+    indices.clear();
+
+    for (u32 ring = 0; ring <= rings; ring++) {
+      float phi = M_PI * ring / rings;  // Latitude angle (0 to π)
+      float y = radius * cos(phi);
+      float ringRadius = radius * sin(phi);
+
+      for (u32 segment = 0; segment <= segments; segment++) {
+        float theta = 2.0f * M_PI * segment / segments;  // Longitude angle (0 to 2π)
+
+        Vertex vertex;
+        vertex.pos.x = ringRadius * cos(theta);
+        vertex.pos.y = y;
+        vertex.pos.z = ringRadius * sin(theta);
+        vertex.color = vertex.pos;
+        vertex.texCoord.x = (float)segment / segments;
+        vertex.texCoord.y = (float)ring / rings;
+        vertices.push_back(vertex);
+      }
+    }
+
+    for (u32 ring = 0; ring < rings; ring++) {
+      for (u32 segment = 0; segment < segments; segment++) {
+        u32 current = ring * (segments + 1) + segment;
+        u32 next = current + segments + 1;
+
+        indices.push_back(current);
+        indices.push_back(current + 1);
+        indices.push_back(next);
+
+        indices.push_back(current + 1);
+        indices.push_back(next + 1);
+        indices.push_back(next);
+      }
+    }
+  }
+
+
+  SceneLayer::SceneLayer(Application &app, const std::string &scene)
+      : Layer(app, "Scene")
+      , scene(scene) {
+    if (scene != "planets") throw std::runtime_error("unknown scene '" + scene + "'");
+  }
+
+
+  void SceneLayer::onAttach(void) {
+    REN_PROFILE_FUNCTION();
+    auto &vulkan = getVulkan();
+
+    auto vertexShader = makeRef<Shader>("shaders/triangle.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    auto fragmentShader =
+        makeRef<Shader>("shaders/triangle.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    // Every texture is in the bindless table, so that's the only set.
+    pipeline = makeRef<StandardPipeline>(vertexShader, fragmentShader,
+                                         BindlessTextures::get().getLayout());
+
+    // ---- Geometry ---- //
+    std::vector<Vertex> vertices;
+    std::vector<u32> indices;
+    generateSphere(vertices, indices, 1.0f, 64, 64);
+    indexCount = static_cast<u32>(indices.size());
+    vertexBuffer = makeRef<StaticVertexBuffer<Vertex>>(vulkan, vertices);
+    vertexBuffer->setName("Planet Vertex Buffer");
+    indexBuffer = makeRef<StaticIndexBuffer>(vulkan, indices);
+    indexBuffer->setName("Planet Index Buffer");
+
+    // The center body used to be mars, but there is only a moon texture in assets/.
+    auto moon = Texture::load("assets/moon.jpg");
+    bodies.push_back(Body{glm::vec3(0.0f, 0.0f, 0.0f), moon});
+    bodies.push_back(Body{glm::vec3(4.0f, 0.0f, 0.0f), moon});
+
+    auto &config = app.getConfig();
+    if (config.particles > 0) particles = makeBox<ParticleSystem>(config.particles);
+
+    // ---- Camera ---- //
+    if (!config.cameraPath.empty()) {
+      cameraPath = CameraPath::load(config.cameraPath);
+    } else if (config.benchmark) {
+      cameraPath = CameraPath::orbit(glm::vec3(2.0f, 0.0f, 0.0f), 6.0f, 1.5f, 10.0f);
+    }
+    camera.position = glm::vec3(2.0f, 1.0f, 6.0f);
+    camera.lookAt(glm::vec3(2.0f, 0.0f, 0.0f));
+  }
+
+
+  void SceneLayer::onDetach(void) {
+    bodies.clear();
+    particles.reset();
+    vertexBuffer.reset();
+    indexBuffer.reset();
+    pipeline.reset();
+  }
+
+
+  void SceneLayer::onUpdate(float deltaTime) {
+    time += deltaTime;
+    this->deltaTime = deltaTime;
+    if (!cameraPath.empty()) {
+      cameraPath.apply(camera, time);
+    } else if (!app.isHeadless()) {
+      // Camera::update reads SDL input and ImGui's capture flags.
+      camera.update(deltaTime);
+    }
+  }
+
+
+  void SceneLayer::onRender(void) {
+    REN_PROFILE_FUNCTION();
+    auto &renderer = Renderer::get();
+
+    auto extent = renderer.getExtent();
+    auto matProj =
+        glm::perspective(glm::radians(fov), extent.width / (float)extent.height, fNear, fFar);
+    matProj[1][1] *= -1;
+    auto matView = camera.view_matrix();
+
+    // Kick off the particle step first, so it runs while the frame is recorded.
+    if (particles) {
+      auto compute = renderer.beginCompute();
+      particles->simulate(compute, deltaTime);
+      // Only the point shader reads the particles.
+      renderer.submitCompute(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+    }
+
+    // Each chunk of bodies is recorded into its own secondary on a worker.
+    // The chunk's first body is its order, so they're executed in body order.
+    auto count = static_cast<u32>(bodies.size());
+    JobSystem::get().parallelFor(0, count, BODIES_PER_JOB, [&](u32 begin, u32 end) {
+      REN_PROFILE_SCOPE("Record Bodies");
+      auto cmd = renderer.beginCommands(Renderer::ORDER_SCENE + begin);
+      {
+        REN_GPU_SCOPE(cmd, "Scene");
+        bind(cmd, *pipeline);
+        bind(cmd, *vertexBuffer);
+        bind(cmd, *indexBuffer);
+        // Bound once: the bodies pick their texture out of it by index.
+        pipeline->bindDescriptorSet(cmd, BindlessTextures::get().getSet());
+
+        for (u32 i = begin; i < end; i++) {
+          auto &body = bodies[i];
+          MeshPushConstants pushConstants{};
+          pushConstants.model = glm::translate(glm::mat4(1.0), body.position);
+          pushConstants.view = matView;
+          pushConstants.proj = matProj;
+          pushConstants.textureIndex = body.texture->getBindlessIndex();
+          pipeline->pushConstants(cmd, pushConstants);
+
+          vkCmdDrawIndexed(cmd, indexCount, 1, 0, 0, 0);
+        }
+      }
+      renderer.endCommands(cmd);
+      renderer.getStats().drawCalls += end - begin;
+    });
+
+    // The particles are blended, so they go after every body.
+    if (particles) {
+      auto cmd = renderer.beginCommands(Renderer::ORDER_SCENE + count);
+      {
+        REN_GPU_SCOPE(cmd, "Particles");
+        particles->draw(cmd, matView, matProj);
+      }
+      renderer.endCommands(cmd);
+      renderer.getStats().drawCalls += 1;
+    }
+  }
+
+}  // namespace ren
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <ren/types.h>
+#include <ren/layers/Layer.h>
+#include <ren/Camera.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/renderer/Texture.h>
+#include <ren/renderer/pipelines/StandardPipeline.h>
+#include <ren/renderer/ParticleSystem.h>
+
+namespace ren {
+
+  // Draws the world. The only scene so far is "planets": a couple of textured
+  // spheres, orbited by a cloud of particles simulated with async compute.
+  // When the application is benchmarking, the camera follows a CameraPath
+  // (advanced by the fixed frame step) instead of the user's input.
+  class SceneLayer : public Layer {
+   public:
+    // Throws if `scene` isn't a scene we know how to build.
+    SceneLayer(Application &app, const std::string &scene);
+    ~SceneLayer() override = default;
+
+    void onAttach(void) override;
+    void onDetach(void) override;
+    void onUpdate(float deltaTime) override;
+    void onRender(void) override;
+
+   private:
+    // How many bodies one recording job draws.
+    static constexpr u32 BODIES_PER_JOB = 64;
+
+    struct Body {
+      glm::vec3 position;
+      ref<Texture> texture;
+    };
+
+    std::string scene;
+    Camera camera;
+    // Only used when benchmarking.
+    CameraPath cameraPath;
+    float time = 0.0f;
+    // The step the particles take this frame.
+    float deltaTime = 0.0f;
+
+    float fov = 90.0f;
+    float fNear = 0.01f;
+    float fFar = 1000.0f;
+
+    ref<StandardPipeline> pipeline;
+    ref<StaticVertexBuffer<Vertex>> vertexBuffer;
+    ref<StaticIndexBuffer> indexBuffer;
+    u32 indexCount = 0;
+    std::vector<Body> bodies;
+    box<ParticleSystem> particles;
+  };
+}  // namespace ren
@@ -6,9 +6,9 @@
 #include <ren/core/Application.h>
 
 int main(int argc, char *argv[]) {
-  REN_PROFILE_BEGIN_SESSION("Engine Run", "engine_run_profile.json");
+  REN_PROFILE_BEGIN_SESSION("Engine Run", "engine_run_profile.rtrace");
 
-  ren::Application app("ren", {1920, 1080});
+  ren::Application app(ren::ApplicationConfig::fromArgs(argc, argv));
 
   app.run();
   // REN_PROFILE_OUTPUT(false);
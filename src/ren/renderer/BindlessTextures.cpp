@@ -0,0 +1,136 @@
+#include <ren/renderer/BindlessTextures.h>
+#include <ren/renderer/Vulkan.h>
+#include <algorithm>
+
+namespace ren {
+
+  static BindlessTextures *g_bindless = nullptr;
+  BindlessTextures &BindlessTextures::get(void) {
+    if (g_bindless == nullptr) throw std::runtime_error("BindlessTextures not initialized");
+    return *g_bindless;
+  }
+
+
+  BindlessTextures::BindlessTextures(VulkanInstance &vulkan)
+      : vulkan(vulkan) {
+    // Every slot counts against the update after bind limits, even unwritten ones.
+    VkPhysicalDeviceVulkan12Properties props12{};
+    props12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 props{};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &props12;
+    vkGetPhysicalDeviceProperties2(vulkan.physical_device, &props);
+    capacity = std::min({MAX_TEXTURES, props12.maxDescriptorSetUpdateAfterBindSampledImages,
+                         props12.maxDescriptorSetUpdateAfterBindSamplers,
+                         props12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                         props12.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    // ---- Layout ---- //
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = BINDING;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = capacity;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    // Partially bound: slots nobody registered are never written. Update
+    // after bind (and while pending): textures can come and go while frames
+    // that don't use them are recorded or in flight.
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 1;
+    flagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    VK_CHECK(vkCreateDescriptorSetLayout(vulkan.device, &layoutInfo, nullptr, &layout));
+
+    // ---- The one set ---- //
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity};
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(vulkan.device, &poolInfo, nullptr, &pool));
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    VK_CHECK(vkAllocateDescriptorSets(vulkan.device, &allocInfo, &set));
+
+    fmt::print("Bindless texture table: {} slots\n", capacity);
+    g_bindless = this;
+  }
+
+
+  BindlessTextures::~BindlessTextures(void) {
+    if (g_bindless == this) g_bindless = nullptr;
+    // Frames in flight may still have the set bound.
+    DeletionQueue::defer([device = vulkan.device, pool = pool, layout = layout] {
+      vkDestroyDescriptorPool(device, pool, nullptr);
+      vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    });
+  }
+
+
+  u32 BindlessTextures::add(VkImageView view, VkSampler sampler) {
+    if (g_bindless == nullptr) return INVALID;
+    auto &table = *g_bindless;
+    std::lock_guard lock(table.mutex);
+
+    u32 index;
+    if (!table.free.empty()) {
+      index = table.free.back();
+      table.free.pop_back();
+    } else if (table.next < table.capacity) {
+      index = table.next++;
+    } else {
+      throw std::runtime_error(
+          fmt::format("Bindless texture table is full ({} textures)", table.capacity));
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = table.set;
+    write.dstBinding = BINDING;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(table.vulkan.device, 1, &write, 0, nullptr);
+    return index;
+  }
+
+
+  void BindlessTextures::release(u32 index) {
+    if (index == INVALID) return;
+    // Frames in flight may still sample the slot, so only reuse it once they're done.
+    DeletionQueue::defer([index] {
+      if (g_bindless == nullptr) return;
+      std::lock_guard lock(g_bindless->mutex);
+      g_bindless->free.push_back(index);
+    });
+  }
+
+
+  u32 BindlessTextures::getCount(void) const {
+    std::lock_guard lock(mutex);
+    return next - static_cast<u32>(free.size());
+  }
+
+}  // namespace ren
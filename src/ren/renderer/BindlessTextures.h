@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ren/types.h>
+#include <mutex>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // One descriptor set holding every texture, as a big array of combined
+  // image samplers (descriptor indexing: partially bound and update after
+  // bind). Each Texture registers itself and gets a stable index into the
+  // array, which shaders read from push constants or per-instance data. The
+  // set is bound once, so drawing differently textured objects doesn't bind
+  // anything per draw.
+  //
+  // Slots that nothing registered are never written, so shaders must only
+  // index with indices they were given. A released slot isn't handed out
+  // again until the frames that could have used it are done.
+  class BindlessTextures {
+   public:
+    // The binding the array is at.
+    static constexpr u32 BINDING = 0;
+    // Never a valid index.
+    static constexpr u32 INVALID = UINT32_MAX;
+    // How many slots we ask for, if the device allows that many.
+    static constexpr u32 MAX_TEXTURES = 16384;
+
+    BindlessTextures(VulkanInstance &vulkan);
+    ~BindlessTextures(void);
+
+    BindlessTextures(const BindlessTextures &) = delete;
+    BindlessTextures &operator=(const BindlessTextures &) = delete;
+
+    static BindlessTextures &get(void);
+
+    // Write `view` and `sampler` into a free slot and return its index. Any
+    // thread. Returns INVALID if there is no table (yet, or anymore).
+    static u32 add(VkImageView view, VkSampler sampler);
+    // Give the slot back once the GPU is done with it. Any thread.
+    static void release(u32 index);
+
+    VkDescriptorSetLayout getLayout(void) const { return layout; }
+    VkDescriptorSet getSet(void) const { return set; }
+    u32 getCapacity(void) const { return capacity; }
+    u32 getCount(void) const;
+
+   private:
+    VulkanInstance &vulkan;
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    u32 capacity = 0;
+
+    // Guards the free list, and the set (updates must be externally synchronized).
+    mutable std::mutex mutex;
+    // Slots below `next` that have been released.
+    std::vector<u32> free;
+    u32 next = 0;
+  };
+
+}  // namespace ren
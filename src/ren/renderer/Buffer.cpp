@@ -1,5 +1,7 @@
 #include <ren/renderer/Vulkan.h>
+#include <ren/renderer/UploadQueue.h>
 #include <ren/core/Instrumentation.h>
+#include <algorithm>
 
 ren::Buffer::Buffer(VulkanInstance &vulkan_instance, VkDeviceSize size, VkBufferUsageFlags usage,
                     VkMemoryPropertyFlags properties)
@@ -7,11 +9,12 @@ ren::Buffer::Buffer(VulkanInstance &vulkan_instance, VkDeviceSize size, VkBuffer
     : vulkan(vulkan_instance)
     , size(size)
     , usage(usage)
-    , properties(properties) {
+    , properties(properties)
+    , category(MemoryPools::categorize(usage, properties)) {
   REN_PROFILE_FUNCTION();
 
   // Allocate the buffer using vma
-  switch (usage) {
+  switch (usage & ~(VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) {
     case VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT: setName("UniformBuffer"); break;
     case VK_BUFFER_USAGE_STORAGE_BUFFER_BIT: setName("StorageBuffer"); break;
     case VK_BUFFER_USAGE_VERTEX_BUFFER_BIT: setName("VertexBuffer"); break;
@@ -24,8 +27,13 @@ ren::Buffer::Buffer(VulkanInstance &vulkan_instance, VkDeviceSize size, VkBuffer
 
 ren::Buffer::~Buffer() {
   unmap();
+  ren::DescriptorCache::forget((u64)buffer);
 
-  vmaDestroyBuffer(vulkan.allocator, buffer, allocation);
+  // Frames in flight (or an upload batch) may still be using it.
+  ren::DeletionQueue::defer([allocator = vulkan.allocator, buffer = buffer,
+                             allocation = allocation] {
+    vmaDestroyBuffer(allocator, buffer, allocation);
+  });
 }
 
 void ren::Buffer::resize(size_t new_bytes) {
@@ -37,14 +45,41 @@ void ren::Buffer::resize(size_t new_bytes) {
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  VmaAllocationCreateInfo allocInfo = {};
-  allocInfo.preferredFlags = properties;
-  allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-  allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
-                    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+  // Storage buffers are what async compute writes and graphics reads, so share
+  // them between every family we use instead of transferring ownership every frame.
+  // Staging buffers are read by the transfer queue, and by the graphics queue
+  // for the copies it does itself (see UploadQueue::copyOnGraphics).
+  std::vector<u32> families = {vulkan.graphics_queue_family};
+  for (u32 family : {vulkan.compute_queue_family, vulkan.transfer_queue_family}) {
+    if (std::find(families.begin(), families.end(), family) == families.end()) {
+      families.push_back(family);
+    }
+  }
+  bool shared = (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) || category == MemoryCategory::Staging;
+  concurrent = shared && families.size() > 1;
+  if (concurrent) {
+    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    bufferInfo.queueFamilyIndexCount = static_cast<u32>(families.size());
+    bufferInfo.pQueueFamilyIndices = families.data();
+  }
 
+  // Sub-allocated from the category's pool where possible (see MemoryPools).
+  VmaAllocationCreateInfo allocInfo =
+      vulkan.memory->getBufferAllocation(category, usage, bufferInfo.size);
+  allocInfo.preferredFlags = properties;
 
-  vmaCreateBuffer(vulkan.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+  VkResult res =
+      vmaCreateBuffer(vulkan.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+  if (res != VK_SUCCESS && allocInfo.pool != VK_NULL_HANDLE) {
+    // The driver can insist on a dedicated allocation, which a pool with
+    // fixed size blocks can't give it.
+    allocInfo.pool = VK_NULL_HANDLE;
+    res = vmaCreateBuffer(vulkan.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+  }
+  if (res != VK_SUCCESS) {
+    throw std::runtime_error(fmt::format("Failed to allocate {} ({} bytes): {}", name,
+                                         bufferInfo.size, (int)res));
+  }
 }
 
 
@@ -68,7 +103,8 @@ void ren::Buffer::unmap(void) {
 
 void ren::Buffer::copyFrom(const Buffer &src, VkDeviceSize size, VkDeviceSize srcOffset,
                            VkDeviceSize dstOffset) {
-  this->vulkan.copy_buffer(src.buffer, this->buffer, size);
+  // Batched, but `src` is only destroyed once the copy is done (see DeletionQueue).
+  UploadQueue::get().copyBuffer(src, *this, size, srcOffset, dstOffset);
 }
 
 
@@ -76,10 +112,35 @@ void ren::Buffer::copyFromHost(const void *data, VkDeviceSize size, VkDeviceSize
   // Ensure the size is within bounds
   if (offset + size > this->size) { throw std::runtime_error("Buffer copy exceeds buffer size"); }
 
-  // Map the buffer and copy the data
+  // Memory the host can't see is staged (so the buffer needs TRANSFER_DST
+  // usage). So are Static buffers, unless direct writes are turned on.
+  VkMemoryPropertyFlags memoryFlags;
+  vmaGetAllocationMemoryProperties(vulkan.allocator, allocation, &memoryFlags);
+  bool direct = (memoryFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+  if (category == MemoryCategory::Static) direct &= vulkan.memory->isStaticHostVisible();
+  if (!direct) {
+    UploadQueue::get().uploadBuffer(*this, data, size, offset);
+    return;
+  }
+
+  // Stays mapped, so the next copy is just the memcpy.
   void *mappedData = this->map();
   std::memcpy(static_cast<u8 *>(mappedData) + offset, data, size);
-  this->unmap();
+}
+
+
+VkDeviceSize ren::getOffsetAlignment(VulkanInstance &vulkan, VkBufferUsageFlags usage) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(vulkan.physical_device, &props);
+
+  VkDeviceSize alignment = 1;
+  if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT)) {
+    alignment = std::max(alignment, props.limits.minUniformBufferOffsetAlignment);
+  }
+  if (usage & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) {
+    alignment = std::max(alignment, props.limits.minStorageBufferOffsetAlignment);
+  }
+  return alignment;
 }
 
 
@@ -2,7 +2,11 @@
 
 #include <ren/types.h>
 #include <ren/core/Instrumentation.h>
+#include <ren/renderer/MemoryPools.h>
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <vector>
 
 namespace ren {
@@ -23,6 +27,8 @@ namespace ren {
     Buffer &operator=(Buffer &&other) noexcept;
 
 
+    // Host visible buffers stay mapped once they've been mapped, until unmap()
+    // (or the buffer is destroyed).
     void *map(void);
     void unmap(void);
 
@@ -35,6 +41,10 @@ namespace ren {
     VkBuffer getHandle() const { return buffer; }
     VkDeviceSize getSize() const { return size; }
     bool isMapped() const { return mapped != nullptr; }
+    // Shared between queue families, so it never needs an ownership transfer.
+    bool isConcurrent() const { return concurrent; }
+    // Derived from the usage and memory properties it was created with.
+    MemoryCategory getCategory() const { return category; }
     const std::string &getName() const { return name; }
     void setName(const std::string &new_name);
 
@@ -51,8 +61,10 @@ namespace ren {
 
     VkBufferUsageFlags usage;
     VkMemoryPropertyFlags properties;
+    MemoryCategory category;
 
     void *mapped = nullptr;
+    bool concurrent = false;
   };
 
 
@@ -67,7 +79,7 @@ namespace ren {
 
 
     // Wrap the map function in something typed
-    T *map(void) { return Buffer::map(); }
+    T *map(void) { return static_cast<T *>(Buffer::map()); }
 
     void copyFromHost(const T *data, VkDeviceSize size, VkDeviceSize offset = 0) {
       return Buffer::copyFromHost((const void *)data, size * sizeof(T), offset);
@@ -103,12 +115,135 @@ namespace ren {
 
 
 
+  // A buffer the GPU reads far more often than the CPU writes it, in device
+  // local memory (MemoryCategory::Static). The initial contents, and any
+  // later copyFromHost(), go through the UploadQueue's staging ring, and are
+  // there for the next frame. Where device local memory is host visible
+  // (resizable BAR, integrated GPUs) they're written in place instead.
+  template <typename T, VkBufferUsageFlags usage>
+  class StaticBuffer : public TypedBuffer<T> {
+   public:
+    static constexpr VkBufferUsageFlags USAGE = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    StaticBuffer(VulkanInstance &vulkan, size_t count)
+        : TypedBuffer<T>(vulkan, count, USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {}
+
+    StaticBuffer(VulkanInstance &vulkan, const T *initial, size_t count)
+        : TypedBuffer<T>(vulkan, count, USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+      this->copyFromHost(initial, count);
+    }
+
+    StaticBuffer(VulkanInstance &vulkan, const std::vector<T> &initial)
+        : TypedBuffer<T>(vulkan, initial.size(), USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
+      this->copyFromHost(initial.data(), initial.size());
+    }
+
+    virtual ~StaticBuffer() = default;
+  };
+
+
+
+  // The alignment a buffer with `usage` needs for dynamic offsets into it:
+  // the device's min*BufferOffsetAlignment for uniform and storage buffers.
+  VkDeviceSize getOffsetAlignment(VulkanInstance &vulkan, VkBufferUsageFlags usage);
+
+
+  // Data the CPU writes every frame and the GPU reads in that frame only, in
+  // host visible memory (MemoryCategory::Dynamic). The buffer is mapped for
+  // its whole lifetime and split into MAX_FRAMES_IN_FLIGHT regions, one per
+  // frame in flight. beginFrame() rewinds the frame's region, and allocate()
+  // bumps a pointer through it, so writing per-frame data never calls into
+  // Vulkan. Bind the buffer with the offset allocate() returns (as a dynamic
+  // offset, or a vertex/index buffer offset).
+  //
+  // A frame's region is only rewound once the Renderer has waited for that
+  // frame's last submission, so nothing the GPU is reading gets overwritten.
+  template <typename T>
+  class DynamicBuffer : public TypedBuffer<T> {
+   public:
+    struct Slice {
+      T *data;
+      // From the start of the buffer, in bytes.
+      VkDeviceSize offset;
+    };
+
+    // Room for `countPerFrame` entries in each frame's region.
+    DynamicBuffer(VulkanInstance &vulkan, size_t countPerFrame, VkBufferUsageFlags usage)
+        : DynamicBuffer(vulkan, countPerFrame, usage,
+                        std::max<VkDeviceSize>(getOffsetAlignment(vulkan, usage), alignof(T))) {}
+    virtual ~DynamicBuffer() = default;
+
+    // Start writing frame `frameIndex` (FrameData::frameIndex). Main thread,
+    // before anything allocates from the frame.
+    void beginFrame(u32 frameIndex) {
+      base = static_cast<u8 *>(Buffer::map()) + frameIndex * regionSize;
+      baseOffset = frameIndex * regionSize;
+      head.store(0, std::memory_order_relaxed);
+    }
+
+    // Reserve `count` entries in the current frame. Any thread. Throws if the
+    // region is full.
+    Slice allocate(size_t count = 1) {
+      VkDeviceSize bytes = (count * sizeof(T) + alignment - 1) & ~(alignment - 1);
+      VkDeviceSize at = head.fetch_add(bytes, std::memory_order_relaxed);
+      if (at + bytes > regionSize) {
+        throw std::runtime_error(fmt::format("{} is out of room for this frame", this->name));
+      }
+      return {reinterpret_cast<T *>(base + at), baseOffset + at};
+    }
+
+    Slice push(const T *data, size_t count) {
+      Slice slice = allocate(count);
+      std::memcpy(slice.data, data, count * sizeof(T));
+      return slice;
+    }
+    Slice push(const T &value) { return push(&value, 1); }
+
+    VkDeviceSize getRegionSize(void) const { return regionSize; }
+    // Bytes allocated from the current frame so far.
+    VkDeviceSize getUsed(void) const {
+      return std::min(head.load(std::memory_order_relaxed), regionSize);
+    }
+
+   private:
+    DynamicBuffer(VulkanInstance &vulkan, size_t countPerFrame, VkBufferUsageFlags usage,
+                  VkDeviceSize alignment)
+        : TypedBuffer<T>(vulkan,
+                         regionBytes(countPerFrame, alignment) * MAX_FRAMES_IN_FLIGHT / sizeof(T),
+                         usage,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        , alignment(alignment)
+        , regionSize(regionBytes(countPerFrame, alignment)) {
+      beginFrame(0);
+    }
+
+    // Regions are whole multiples of the alignment (so every region starts
+    // aligned) and of sizeof(T) (so the buffer is a whole number of entries).
+    static VkDeviceSize regionBytes(size_t count, VkDeviceSize alignment) {
+      VkDeviceSize granule = alignment;
+      while (granule % sizeof(T) != 0) granule += alignment;
+      return (count * sizeof(T) + granule - 1) / granule * granule;
+    }
+
+    VkDeviceSize alignment;
+    VkDeviceSize regionSize;
+    u8 *base = nullptr;
+    VkDeviceSize baseOffset = 0;
+    std::atomic<VkDeviceSize> head = 0;
+  };
+
+
+
   template <typename T>
   using VertexBuffer = FixedUsageTypedBuffer<T, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT>;
   using IndexBuffer = FixedUsageTypedBuffer<u32, VK_BUFFER_USAGE_INDEX_BUFFER_BIT>;
   template <typename T>
   using UniformBuffer = FixedUsageTypedBuffer<T, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT>;
 
+  template <typename T>
+  using StaticVertexBuffer = StaticBuffer<T, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT>;
+  using StaticIndexBuffer = StaticBuffer<u32, VK_BUFFER_USAGE_INDEX_BUFFER_BIT>;
+
 
   template <typename T>
   inline void bind(VkCommandBuffer cmd, VertexBuffer<T> &buf) {
@@ -124,4 +259,17 @@ namespace ren {
     vkCmdBindIndexBuffer(cmd, buf.getHandle(), 0, VK_INDEX_TYPE_UINT32);
   }
 
+
+  template <typename T>
+  inline void bind(VkCommandBuffer cmd, StaticVertexBuffer<T> &buf) {
+    VkBuffer vertexBuffers[] = {buf.getHandle()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+  }
+
+
+  inline void bind(VkCommandBuffer cmd, StaticIndexBuffer &buf) {
+    vkCmdBindIndexBuffer(cmd, buf.getHandle(), 0, VK_INDEX_TYPE_UINT32);
+  }
+
 }  // namespace ren
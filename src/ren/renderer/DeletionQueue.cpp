@@ -0,0 +1,83 @@
+#include <ren/renderer/DeletionQueue.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/core/Instrumentation.h>
+
+namespace ren {
+
+  static DeletionQueue *g_deletionQueue = nullptr;
+  DeletionQueue &DeletionQueue::get(void) {
+    if (g_deletionQueue == nullptr) { throw std::runtime_error("DeletionQueue not initialized"); }
+    return *g_deletionQueue;
+  }
+
+
+  DeletionQueue::DeletionQueue(VulkanInstance &vulkan)
+      : vulkan(vulkan) {
+    g_deletionQueue = this;
+  }
+
+
+  DeletionQueue::~DeletionQueue(void) {
+    flush();
+    if (g_deletionQueue == this) g_deletionQueue = nullptr;
+  }
+
+
+  void DeletionQueue::defer(Deletion deletion) {
+    if (g_deletionQueue == nullptr) {
+      deletion();
+      return;
+    }
+    std::lock_guard lock(g_deletionQueue->mutex);
+    g_deletionQueue->pending.push_back(std::move(deletion));
+  }
+
+
+  void DeletionQueue::submitted(u64 value) {
+    std::lock_guard lock(mutex);
+    if (pending.empty()) return;
+    batches.push_back({value, std::move(pending)});
+    pending.clear();
+  }
+
+
+  void DeletionQueue::collect(void) {
+    REN_PROFILE_FUNCTION();
+    std::vector<Batch> ready;
+    {
+      std::lock_guard lock(mutex);
+      while (!batches.empty() && vulkan.graphics_timeline->isComplete(batches.front().value)) {
+        ready.push_back(std::move(batches.front()));
+        batches.pop_front();
+      }
+    }
+
+    // Outside the lock: a deletion may release something that defers more.
+    u32 count = 0;
+    for (auto &batch : ready) {
+      for (auto &deletion : batch.deletions) deletion();
+      count += static_cast<u32>(batch.deletions.size());
+    }
+    REN_PROFILE_COUNTER("Deferred Deletions", count);
+  }
+
+
+  void DeletionQueue::flush(void) {
+    // Deletions can defer more of them, so keep going until nothing is left.
+    while (true) {
+      std::vector<Deletion> deletions;
+      {
+        std::lock_guard lock(mutex);
+        for (auto &batch : batches) {
+          for (auto &deletion : batch.deletions) deletions.push_back(std::move(deletion));
+        }
+        batches.clear();
+        for (auto &deletion : pending) deletions.push_back(std::move(deletion));
+        pending.clear();
+      }
+      if (deletions.empty()) return;
+      for (auto &deletion : deletions) deletion();
+    }
+  }
+
+}  // namespace ren
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ren/types.h>
+#include <deque>
+#include <mutex>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // Destroys Vulkan objects once the GPU can no longer be using them, so a
+  // ref<> can be dropped at any point (mid-frame, from any thread) without
+  // waiting on the device first.
+  //
+  // Deletions queued while a frame is being recorded could still be used by
+  // that frame, so they're tagged with the graphics timeline value its
+  // submission signals (see submitted()). That submission waits on the
+  // frame's compute and uploads, so reaching it covers every queue. Once the
+  // timeline gets there, collect() runs them.
+  class DeletionQueue {
+   public:
+    using Deletion = std::function<void()>;
+
+    DeletionQueue(VulkanInstance &vulkan);
+    // Runs everything still queued. The device must be idle.
+    ~DeletionQueue(void);
+
+    DeletionQueue(const DeletionQueue &) = delete;
+    DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+    static DeletionQueue &get(void);
+
+    // Queue `deletion` on the deletion queue, or run it right away if there
+    // isn't one (before the renderer starts or after it shuts down, when
+    // nothing can be in flight). Any thread.
+    static void defer(Deletion deletion);
+
+    // The frame being recorded was submitted, and signals `value` on the
+    // graphics timeline. Everything deferred since the last call waits for it.
+    void submitted(u64 value);
+    // Run the deletions the GPU is done with. Never blocks.
+    void collect(void);
+    // Run every deletion now. The device must be idle.
+    void flush(void);
+
+   private:
+    struct Batch {
+      u64 value;
+      std::vector<Deletion> deletions;
+    };
+
+    VulkanInstance &vulkan;
+    std::mutex mutex;
+    // Deferred since the last submission.
+    std::vector<Deletion> pending;
+    // Waiting on the graphics timeline, oldest first.
+    std::deque<Batch> batches;
+  };
+
+}  // namespace ren
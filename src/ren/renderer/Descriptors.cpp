@@ -0,0 +1,319 @@
+#include <ren/renderer/Descriptors.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/core/Instrumentation.h>
+#include <algorithm>
+
+namespace ren {
+
+  // ---- DescriptorAllocator ---- //
+
+  const std::vector<DescriptorAllocator::PoolRatio> DescriptorAllocator::DEFAULT_RATIOS = {
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f},
+  };
+
+
+  DescriptorAllocator::DescriptorAllocator(VulkanInstance &vulkan,
+                                           const std::vector<PoolRatio> &ratios, bool freeable)
+      : vulkan(vulkan)
+      , ratios(ratios)
+      , freeable(freeable) {}
+
+
+  DescriptorAllocator::~DescriptorAllocator(void) {
+    std::vector<VkDescriptorPool> pools = std::move(ready);
+    pools.insert(pools.end(), full.begin(), full.end());
+    if (current != VK_NULL_HANDLE) pools.push_back(current);
+    // Frames in flight may still be using the sets.
+    DeletionQueue::defer([device = vulkan.device, pools = std::move(pools)] {
+      for (auto pool : pools) vkDestroyDescriptorPool(device, pool, nullptr);
+    });
+  }
+
+
+  VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout,
+                                                VkDescriptorPool *pool) {
+    std::lock_guard lock(mutex);
+    if (current == VK_NULL_HANDLE) current = takePool();
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = current;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(vulkan.device, &allocInfo, &set);
+    while (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+      // Full. Move on to a pool with room. One that only has room because
+      // sets were freed from it may still not fit this one, so keep going.
+      full.push_back(current);
+      bool created = ready.empty();
+      current = takePool();
+      allocInfo.descriptorPool = current;
+      result = vkAllocateDescriptorSets(vulkan.device, &allocInfo, &set);
+
+      // A new pool is as empty as it gets, so the layout needs a descriptor
+      // type or count our ratios don't have, and every pool after it would too.
+      if (created && result != VK_SUCCESS) {
+        throw std::runtime_error(
+            fmt::format("Layout {} doesn't fit in a new descriptor pool (VkResult {})",
+                        (void *)layout, (int)result));
+      }
+    }
+    VK_CHECK(result);
+
+    allocated.fetch_add(1, std::memory_order_relaxed);
+    if (pool != nullptr) *pool = current;
+    return set;
+  }
+
+
+  void DescriptorAllocator::free(VkDescriptorPool pool, VkDescriptorSet set) {
+    if (!freeable) throw std::runtime_error("DescriptorAllocator isn't freeable");
+
+    std::lock_guard lock(mutex);
+    VK_CHECK(vkFreeDescriptorSets(vulkan.device, pool, 1, &set));
+    allocated.fetch_sub(1, std::memory_order_relaxed);
+
+    // It has room again.
+    auto it = std::find(full.begin(), full.end(), pool);
+    if (it != full.end()) {
+      full.erase(it);
+      ready.push_back(pool);
+    }
+  }
+
+
+  void DescriptorAllocator::reset(void) {
+    std::lock_guard lock(mutex);
+    if (current != VK_NULL_HANDLE) full.push_back(current);
+    current = VK_NULL_HANDLE;
+    for (auto pool : full) {
+      vkResetDescriptorPool(vulkan.device, pool, 0);
+      ready.push_back(pool);
+    }
+    full.clear();
+    allocated.store(0, std::memory_order_relaxed);
+  }
+
+
+  u32 DescriptorAllocator::getPoolCount(void) const {
+    std::lock_guard lock(mutex);
+    return static_cast<u32>(ready.size() + full.size() + (current != VK_NULL_HANDLE ? 1 : 0));
+  }
+
+
+  VkDescriptorPool DescriptorAllocator::takePool(void) {
+    if (!ready.empty()) {
+      VkDescriptorPool pool = ready.back();
+      ready.pop_back();
+      return pool;
+    }
+    VkDescriptorPool pool = createPool(nextPoolSets);
+    nextPoolSets = std::min(nextPoolSets * 2, MAX_SETS);
+    return pool;
+  }
+
+
+  VkDescriptorPool DescriptorAllocator::createPool(u32 sets) {
+    REN_PROFILE_FUNCTION();
+    std::vector<VkDescriptorPoolSize> sizes;
+    for (auto &ratio : ratios) {
+      sizes.push_back({ratio.type, std::max<u32>(1, static_cast<u32>(ratio.ratio * sets))});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    if (freeable) poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = sets;
+    poolInfo.poolSizeCount = static_cast<u32>(sizes.size());
+    poolInfo.pPoolSizes = sizes.data();
+
+    VkDescriptorPool pool;
+    VK_CHECK(vkCreateDescriptorPool(vulkan.device, &poolInfo, nullptr, &pool));
+    return pool;
+  }
+
+
+  // ---- DescriptorBindings ---- //
+
+  DescriptorBindings &DescriptorBindings::image(u32 binding, VkImageView view, VkSampler sampler,
+                                                VkDescriptorType type, VkImageLayout layout) {
+    bindings.push_back(Binding{binding, type, {sampler, view, layout}, {}});
+    return *this;
+  }
+
+
+  DescriptorBindings &DescriptorBindings::buffer(u32 binding, VkBuffer buffer,
+                                                 VkDescriptorType type, VkDeviceSize offset,
+                                                 VkDeviceSize range) {
+    bindings.push_back(Binding{binding, type, {}, {buffer, offset, range}});
+    return *this;
+  }
+
+
+  void DescriptorBindings::write(VkDevice device, VkDescriptorSet set) const {
+    std::vector<VkWriteDescriptorSet> writes(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++) {
+      auto &binding = bindings[i];
+      auto &write = writes[i];
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.dstSet = set;
+      write.dstBinding = binding.binding;
+      write.dstArrayElement = 0;
+      write.descriptorType = binding.type;
+      write.descriptorCount = 1;
+      if (binding.buffer.buffer != VK_NULL_HANDLE) {
+        write.pBufferInfo = &binding.buffer;
+      } else {
+        write.pImageInfo = &binding.image;
+      }
+    }
+    vkUpdateDescriptorSets(device, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+  }
+
+
+  bool DescriptorBindings::uses(u64 handle) const {
+    for (auto &binding : bindings) {
+      if ((u64)binding.image.imageView == handle || (u64)binding.image.sampler == handle ||
+          (u64)binding.buffer.buffer == handle) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  static void hashCombine(size_t &seed, u64 value) {
+    seed ^= std::hash<u64>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+  }
+
+
+  size_t DescriptorBindings::hash(void) const {
+    size_t seed = bindings.size();
+    for (auto &binding : bindings) {
+      hashCombine(seed, binding.binding);
+      hashCombine(seed, binding.type);
+      hashCombine(seed, (u64)binding.image.imageView);
+      hashCombine(seed, (u64)binding.image.sampler);
+      hashCombine(seed, binding.image.imageLayout);
+      hashCombine(seed, (u64)binding.buffer.buffer);
+      hashCombine(seed, binding.buffer.offset);
+      hashCombine(seed, binding.buffer.range);
+    }
+    return seed;
+  }
+
+
+  bool DescriptorBindings::operator==(const DescriptorBindings &other) const {
+    if (bindings.size() != other.bindings.size()) return false;
+    for (size_t i = 0; i < bindings.size(); i++) {
+      auto &a = bindings[i];
+      auto &b = other.bindings[i];
+      if (a.binding != b.binding || a.type != b.type || a.image.imageView != b.image.imageView ||
+          a.image.sampler != b.image.sampler || a.image.imageLayout != b.image.imageLayout ||
+          a.buffer.buffer != b.buffer.buffer || a.buffer.offset != b.buffer.offset ||
+          a.buffer.range != b.buffer.range) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  // ---- DescriptorCache ---- //
+
+  static DescriptorCache *g_descriptorCache = nullptr;
+  DescriptorCache &DescriptorCache::get(void) {
+    if (g_descriptorCache == nullptr) throw std::runtime_error("DescriptorCache not initialized");
+    return *g_descriptorCache;
+  }
+
+
+  DescriptorCache::DescriptorCache(VulkanInstance &vulkan)
+      : vulkan(vulkan)
+      , allocator(vulkan, DescriptorAllocator::DEFAULT_RATIOS, true) {
+    g_descriptorCache = this;
+  }
+
+
+  DescriptorCache::~DescriptorCache(void) {
+    if (g_descriptorCache == this) g_descriptorCache = nullptr;
+  }
+
+
+  size_t DescriptorCache::KeyHash::operator()(const Key &key) const {
+    size_t seed = key.bindings.hash();
+    hashCombine(seed, (u64)key.layout);
+    return seed;
+  }
+
+
+  VkDescriptorSet DescriptorCache::getSet(VkDescriptorSetLayout layout,
+                                          const DescriptorBindings &bindings) {
+    Key key{layout, bindings};
+    std::lock_guard lock(mutex);
+    auto it = sets.find(key);
+    if (it != sets.end()) return it->second.set;
+
+    // Written under the lock, so nobody can be handed the set half written.
+    VkDescriptorPool pool;
+    VkDescriptorSet set = allocator.allocate(layout, &pool);
+    bindings.write(vulkan.device, set);
+    sets.emplace(std::move(key), Entry{set, pool});
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return set;
+  }
+
+
+  void DescriptorCache::forget(u64 handle) {
+    if (g_descriptorCache == nullptr || handle == 0) return;
+    std::vector<Entry> evicted;
+    {
+      std::lock_guard lock(g_descriptorCache->mutex);
+      std::erase_if(g_descriptorCache->sets, [&](const auto &entry) {
+        if (!entry.first.bindings.uses(handle)) return false;
+        evicted.push_back(entry.second);
+        return true;
+      });
+    }
+    release(std::move(evicted));
+  }
+
+
+  void DescriptorCache::forgetLayout(VkDescriptorSetLayout layout) {
+    std::vector<Entry> evicted;
+    {
+      std::lock_guard lock(mutex);
+      std::erase_if(sets, [&](const auto &entry) {
+        if (entry.first.layout != layout) return false;
+        evicted.push_back(entry.second);
+        return true;
+      });
+    }
+    release(std::move(evicted));
+  }
+
+
+  void DescriptorCache::release(std::vector<Entry> evicted) {
+    if (evicted.empty()) return;
+    DeletionQueue::defer([evicted = std::move(evicted)] {
+      // If the cache is gone, so are its pools, and the sets with them.
+      if (g_descriptorCache == nullptr) return;
+      for (auto &entry : evicted) g_descriptorCache->allocator.free(entry.pool, entry.set);
+    });
+  }
+
+
+  size_t DescriptorCache::getSize(void) const {
+    std::lock_guard lock(mutex);
+    return sets.size();
+  }
+
+}  // namespace ren
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <ren/types.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // Hands out descriptor sets from a list of pools, adding a bigger pool
+  // whenever the current one runs out (VK_ERROR_OUT_OF_POOL_MEMORY), so
+  // nobody has to guess up front how many sets of which type they'll need.
+  // Sets are normally never freed one at a time: reset() recycles every pool
+  // at once. A `freeable` allocator can also give single sets back with free().
+  // Allocation is thread safe.
+  class DescriptorAllocator {
+   public:
+    // How many descriptors of `type` a pool gets per set it can hold.
+    struct PoolRatio {
+      VkDescriptorType type;
+      float ratio;
+    };
+
+    // Roughly what our sets look like: mostly images and buffers.
+    static const std::vector<PoolRatio> DEFAULT_RATIOS;
+    static constexpr u32 INITIAL_SETS = 64;
+    static constexpr u32 MAX_SETS = 4096;
+
+    DescriptorAllocator(VulkanInstance &vulkan,
+                        const std::vector<PoolRatio> &ratios = DEFAULT_RATIOS,
+                        bool freeable = false);
+    ~DescriptorAllocator(void);
+
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+    // `pool` is set to the pool the set came from, for free(). Throws if the
+    // layout needs descriptors the ratios don't give a pool.
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout, VkDescriptorPool *pool = nullptr);
+    // Return one set to its pool. Only for freeable allocators, and nothing
+    // still using the set may be in flight.
+    void free(VkDescriptorPool pool, VkDescriptorSet set);
+    // Return every set to the pools. Nothing still using them may be in flight.
+    void reset(void);
+
+    // Sets allocated (and not freed) since the last reset().
+    u32 getAllocated(void) const { return allocated.load(std::memory_order_relaxed); }
+    u32 getPoolCount(void) const;
+
+   private:
+    // Note: you must already own lock on mutex for these.
+    VkDescriptorPool takePool(void);
+    VkDescriptorPool createPool(u32 sets);
+
+    VulkanInstance &vulkan;
+    std::vector<PoolRatio> ratios;
+    bool freeable;
+    mutable std::mutex mutex;
+    // The pool being allocated from.
+    VkDescriptorPool current = VK_NULL_HANDLE;
+    // Pools that have room (reset, or never used).
+    std::vector<VkDescriptorPool> ready;
+    // Pools that ran out since the last reset (or since a set in them was freed).
+    std::vector<VkDescriptorPool> full;
+    // How many sets the next new pool holds. Doubles every time, up to MAX_SETS.
+    u32 nextPoolSets = INITIAL_SETS;
+    std::atomic<u32> allocated = 0;
+  };
+
+
+  // The resources a descriptor set points at, one entry per binding. Two
+  // sets with equal bindings (and layouts) are interchangeable, which is what
+  // lets DescriptorCache share them.
+  class DescriptorBindings {
+   public:
+    DescriptorBindings &image(u32 binding, VkImageView view, VkSampler sampler,
+                              VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                              VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    DescriptorBindings &buffer(u32 binding, VkBuffer buffer,
+                               VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                               VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+    // Point `set` at the resources.
+    void write(VkDevice device, VkDescriptorSet set) const;
+    // Does any binding use this image view, sampler or buffer?
+    bool uses(u64 handle) const;
+
+    size_t hash(void) const;
+    bool operator==(const DescriptorBindings &other) const;
+
+   private:
+    struct Binding {
+      u32 binding;
+      VkDescriptorType type;
+      VkDescriptorImageInfo image;
+      VkDescriptorBufferInfo buffer;
+    };
+    std::vector<Binding> bindings;
+  };
+
+
+  // Long lived descriptor sets, keyed by layout and bindings. Asking for the
+  // same textures or buffers twice returns the same set, so drawing things
+  // that share resources costs one set between them, and nothing is
+  // allocated or written once every combination has been seen.
+  //
+  // Sets point at raw handles, so when an image view, sampler or buffer is
+  // destroyed (and its handle could be reused), forget() drops every set that
+  // used it. Image, Texture and Buffer do this themselves. Frames in flight
+  // may still be using a dropped set, so it goes back to its pool through the
+  // DeletionQueue, and churning through assets doesn't grow the pools.
+  class DescriptorCache {
+   public:
+    DescriptorCache(VulkanInstance &vulkan);
+    ~DescriptorCache(void);
+
+    DescriptorCache(const DescriptorCache &) = delete;
+    DescriptorCache &operator=(const DescriptorCache &) = delete;
+
+    static DescriptorCache &get(void);
+
+    // The set for `bindings`, allocating and writing it the first time. Any thread.
+    VkDescriptorSet getSet(VkDescriptorSetLayout layout, const DescriptorBindings &bindings);
+
+    // Drop the sets that use `handle` (a VkImageView, VkSampler or VkBuffer).
+    // Does nothing if there is no cache.
+    static void forget(u64 handle);
+    // Forget every set using `layout`, before it's destroyed.
+    void forgetLayout(VkDescriptorSetLayout layout);
+
+    // Lookups that had to allocate and write a new set, since the last call.
+    u32 takeMisses(void) { return misses.exchange(0, std::memory_order_relaxed); }
+    size_t getSize(void) const;
+
+   private:
+    struct Key {
+      VkDescriptorSetLayout layout;
+      DescriptorBindings bindings;
+      bool operator==(const Key &other) const = default;
+    };
+    struct KeyHash {
+      size_t operator()(const Key &key) const;
+    };
+    struct Entry {
+      VkDescriptorSet set;
+      VkDescriptorPool pool;
+    };
+
+    // Free the sets once the GPU is done with them.
+    static void release(std::vector<Entry> evicted);
+
+    VulkanInstance &vulkan;
+    DescriptorAllocator allocator;
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> sets;
+    std::atomic<u32> misses = 0;
+  };
+
+}  // namespace ren
@@ -2,104 +2,20 @@
 #include <ren/renderer/Vulkan.h>
 #include <ren/renderer/Swapchain.h>
 #include <ren/core/Application.h>
+#include <ren/core/JobSystem.h>
 #include <fmt/core.h>
 
 
 namespace ren {
-  FrameData::FrameData(u32 frameIndex, Swapchain &sc, VkImage swapchainImage,
-                       VkImageView swapchainImageView) {
-    auto &app = ren::Application::get();
+  FrameData::FrameData(u32 frameIndex) {
     this->frameIndex = frameIndex;
     auto &vulkan = ren::getVulkan();
-    // ---- Add the swapchain image to the deviceImage in the framedata ---- //
-    VkImageCreateInfo imageCreateInfo = {};  // Just so the ren::Image class can have it.
-    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageCreateInfo.format = sc.imageFormat;
-    imageCreateInfo.extent.width = sc.deviceExtent.width;
-    imageCreateInfo.extent.height = sc.deviceExtent.height;
-    imageCreateInfo.extent.depth = 1;
-
-    this->deviceImage = ren::Image::create(fmt::format("device #{}", frameIndex), swapchainImage,
-                                           swapchainImageView,
-                                           VK_NULL_HANDLE,  // Null allocation is a little strange.
-                                           imageCreateInfo);
-
-    this->depthImage = ren::ImageBuilder(fmt::format("depth #{}", frameIndex))
-                           .setWidth(sc.deviceExtent.width)
-                           .setHeight(sc.deviceExtent.height)
-                           .setFormat(sc.depthFormat)
-                           .setUsage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-                           .setViewAspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
-                           .build();
-
-    // allocate the framebuffer
-    VkFramebufferCreateInfo deviceFramebufferCreate{};
-
-    std::array<VkImageView, 2> attachments = {this->deviceImage->getImageView(),
-                                              this->depthImage->getImageView()};
-
-    VkImageView deviceImageView = this->deviceImage->getImageView();
-    deviceFramebufferCreate.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    deviceFramebufferCreate.renderPass = ren::Renderer::get().getRenderPass().getHandle();
-    deviceFramebufferCreate.attachmentCount = attachments.size();
-    deviceFramebufferCreate.pAttachments = attachments.data();
-    deviceFramebufferCreate.width = sc.deviceExtent.width;
-    deviceFramebufferCreate.height = sc.deviceExtent.height;
-    deviceFramebufferCreate.layers = 1;
-    if (vkCreateFramebuffer(vulkan.device, &deviceFramebufferCreate, nullptr,
-                            &this->deviceFramebuffer) != VK_SUCCESS) {
-      throw std::runtime_error("Failed to create device framebuffer");
-    }
 
-    // ---- Allocate render targets ---- //
-
-    // Allocate the render image.
-    // this->renderImage = ren::ImageBuilder(fmt::format("render #{}", frameIndex))
-    //                         .setWidth(sc.renderExtent.width)
-    //                         .setHeight(sc.renderExtent.height)
-    //                         .setFormat(sc.imageFormat)
-    //                         .setInitialLayout(VK_IMAGE_LAYOUT_UNDEFINED)
-    //                         .setUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
-    //                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-    //                                   VK_IMAGE_USAGE_SAMPLED_BIT)
-    //                         .setViewAspectMask(VK_IMAGE_ASPECT_COLOR_BIT)
-    //                         .build();
-
-    // this->renderTexture = makeRef<ren::Texture>(this->renderImage);
-    // this->depthTexture = makeRef<ren::Texture>(this->depthImage);
-
-
-    // std::array<VkImageView, 2> attachments = {this->renderImage->getImageView(),
-    //                                           this->depthImage->getImageView()};
-
-    // VkFramebufferCreateInfo framebufferInfo{};
-    // framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    // framebufferInfo.renderPass = vulkan.renderPass->getHandle();
-    // framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    // framebufferInfo.pAttachments = attachments.data();
-    // framebufferInfo.width = sc.renderExtent.width;
-    // framebufferInfo.height = sc.renderExtent.height;
-    // framebufferInfo.layers = 1;
-
-    // if (vkCreateFramebuffer(vulkan.device, &framebufferInfo, nullptr, &this->renderFramebuffer)
-    // !=
-    //     VK_SUCCESS) {
-    //   throw std::runtime_error("failed to create framebuffer!");
-    // }
-
-    // ---- Allocate the semaphores and fence for this frame ---- //
+    // ---- Allocate the acquire semaphore for this frame ---- //
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     VK_CHECK(
         vkCreateSemaphore(vulkan.device, &semaphoreInfo, nullptr, &this->imageAvailableSemaphore));
-    VK_CHECK(
-        vkCreateSemaphore(vulkan.device, &semaphoreInfo, nullptr, &this->renderFinishedSemaphore));
-
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;  // Start signaled
-    VK_CHECK(vkCreateFence(vulkan.device, &fenceInfo, nullptr, &this->inFlightFence));
 
 
     // ---- Allocate the command buffer for this frame ---- //
@@ -111,21 +27,66 @@ namespace ren {
 
     VkCommandBuffer commandBuffer;
     vkAllocateCommandBuffers(vulkan.device, &allocInfo, &this->commandBuffer);
+
+    this->queries = makeBox<GpuQueryPool>();
+
+    // ---- One pool of secondary command buffers per job system thread ---- //
+    this->threadCommands.resize(JobSystem::get().getThreadCount());
+    for (auto &thread : this->threadCommands) {
+      VkCommandPoolCreateInfo poolInfo{};
+      poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      poolInfo.queueFamilyIndex = vulkan.graphics_queue_family;
+      VK_CHECK(vkCreateCommandPool(vulkan.device, &poolInfo, nullptr, &thread.pool));
+    }
+
+    // ---- Async compute ---- //
+    VkCommandPoolCreateInfo computePoolInfo{};
+    computePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    computePoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    computePoolInfo.queueFamilyIndex = vulkan.compute_queue_family;
+    VK_CHECK(vkCreateCommandPool(vulkan.device, &computePoolInfo, nullptr, &this->computePool));
+
+    allocInfo.commandPool = this->computePool;
+    VK_CHECK(vkAllocateCommandBuffers(vulkan.device, &allocInfo, &this->computeCommandBuffer));
   }
 
 
-  FrameData::~FrameData() {
+  VkCommandBuffer FrameData::allocateSecondary(u32 thread) {
+    auto &commands = this->threadCommands[thread];
+    if (commands.used == commands.buffers.size()) {
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocInfo.commandPool = commands.pool;
+      allocInfo.commandBufferCount = 1;
+
+      VkCommandBuffer buffer;
+      VK_CHECK(vkAllocateCommandBuffers(ren::getVulkan().device, &allocInfo, &buffer));
+      commands.buffers.push_back(buffer);
+    }
+    return commands.buffers[commands.used++];
+  }
+
+
+  void FrameData::resetSecondaries(void) {
     auto &vulkan = ren::getVulkan();
+    for (auto &commands : this->threadCommands) {
+      // Resetting the pool resets every buffer in it at once.
+      if (commands.used > 0) vkResetCommandPool(vulkan.device, commands.pool, 0);
+      commands.used = 0;
+      commands.recorded.clear();
+    }
+  }
+
 
-    // This needs to be done because the ImageView is not managed by the Swapchain
-    vkDestroyImageView(vulkan.device, this->deviceImage->getImageView(), nullptr);
-    this->renderImage.reset();
-    this->depthImage.reset();
-    this->deviceImage.reset();
-    vkDestroyFramebuffer(vulkan.device, this->renderFramebuffer, nullptr);
-    vkDestroyFramebuffer(vulkan.device, this->deviceFramebuffer, nullptr);
+  FrameData::~FrameData() {
+    auto &vulkan = ren::getVulkan();
     vkDestroySemaphore(vulkan.device, this->imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(vulkan.device, this->renderFinishedSemaphore, nullptr);
-    vkDestroyFence(vulkan.device, this->inFlightFence, nullptr);
+    this->queries.reset();
+    for (auto &commands : this->threadCommands) {
+      vkDestroyCommandPool(vulkan.device, commands.pool, nullptr);
+    }
+    vkDestroyCommandPool(vulkan.device, this->computePool, nullptr);
   }
 }  // namespace ren
\ No newline at end of file
@@ -4,58 +4,68 @@
 #include <ren/renderer/Buffer.h>
 #include <ren/renderer/Image.h>
 #include <ren/renderer/Texture.h>
+#include <ren/renderer/GpuProfiler.h>
 
 namespace ren {
 
-
-  struct UniformBufferObject {
-    glm::mat4 model;
-    glm::mat4 view;
-    glm::mat4 proj;
+  struct FrameData;
+  struct SwapchainImage;
+
+  // Get the current frame data from anywhere in the engine.
+  FrameData &getFrameData(void);
+
+  // The secondary command buffers one thread has recorded into a frame. Each
+  // job system thread gets its own pool, so recording never takes a lock.
+  struct ThreadCommands {
+    VkCommandPool pool = VK_NULL_HANDLE;
+    // Every secondary allocated from the pool. They're reused frame to frame.
+    std::vector<VkCommandBuffer> buffers;
+    u32 used = 0;
+    // (order, buffer) for each secondary begun this frame.
+    std::vector<std::pair<u32, VkCommandBuffer>> recorded;
   };
 
-  class Swapchain;
-
-  // This is the data that holds all the per-frame data for the swapchain.
+  // Everything the CPU needs to record one frame, while the GPU may still be
+  // running the previous ones. The Renderer has one of these per frame in
+  // flight (see ApplicationConfig::framesInFlight), and cycles through them.
+  // What has to match a swapchain image lives in the SwapchainImage the
+  // frame acquires instead.
   struct FrameData {
     // Which of the frames in flight this is?
     u32 frameIndex;
-    // These images are used for rendering the scene. They are at "render
-    // resolution", which is typically much lower than the device resolution.
-    ren::ImageRef renderImage = nullptr;  // The color image used for rendering.
-
-    // The framebuffer we target when rendering the scene
-    VkFramebuffer renderFramebuffer = VK_NULL_HANDLE;
-
-
-    // We then have a device image, which is the final image that is presented
-    // to the device in the end. We will blit the render image to this
-    // with some fancy up scaling and whatnot.
-    ren::ImageRef deviceImage = nullptr;
-    ren::ImageRef depthImage = nullptr;  // The depth buffer for rendering.
-
-    // The framebuffer we target when rendering the device image.
-    VkFramebuffer deviceFramebuffer = VK_NULL_HANDLE;
 
+    // The image this frame renders into. Set by Swapchain::acquireNextImage.
+    SwapchainImage *image = nullptr;
 
-    // Semaphores for synchronizing the rendering process.
-
-    // Signals when the image is ready to be rendered to.
+    // Signals when the image is ready to be rendered to. The swapchain only
+    // takes binary semaphores.
     VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
-    // Signals when the rendering is finished and the image is ready to be presented.
-    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
-    // Fence to ensure that the GPU has finished rendering before we can
-    // submit the next frame.
-    VkFence inFlightFence = VK_NULL_HANDLE;
-
-    // The uniform buffer to render this frame's scene.
-    ref<UniformBuffer<UniformBufferObject>> uniformBuffer = nullptr;
+    // The graphics timeline value of this frame's last submission. Once the
+    // timeline reaches it, everything the frame used can be reused.
+    u64 submitValue = 0;
+    // When the frame last submitted started on the CPU (see FrameLimiter::getFrameStart).
+    u64 startTime = 0;
 
     // The command buffer that we record the rendering commands into.
     VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 
-    FrameData(u32 frameIndex, Swapchain &sc, VkImage swapchainImage,
-              VkImageView swapchainImageView);
+    // Timestamp queries for the GPU zones recorded into commandBuffer.
+    box<GpuQueryPool> queries = nullptr;
+
+    // Indexed by JobSystem::getThreadIndex().
+    std::vector<ThreadCommands> threadCommands;
+
+    // Async compute work for this frame (see Renderer::beginCompute). The pool
+    // belongs to the compute queue's family.
+    VkCommandPool computePool = VK_NULL_HANDLE;
+    VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+
+    FrameData(u32 frameIndex);
     ~FrameData();
+
+    // Hand out a secondary command buffer from `thread`'s pool.
+    VkCommandBuffer allocateSecondary(u32 thread);
+    // Reset every thread's pool. Only call once the frame has finished on the GPU.
+    void resetSecondaries(void);
   };
 }  // namespace ren
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <ren/renderer/FrameLimiter.h>
+#include <ren/renderer/GpuProfiler.h>
+#include <ren/core/Instrumentation.h>
+#include <thread>
+
+namespace ren {
+
+  static void smooth(double &average, double sample, double weight) {
+    average = average == 0.0 ? sample : average + (sample - average) * weight;
+  }
+
+
+  void FrameLimiter::wait(void) {
+    REN_PROFILE_FUNCTION();
+    u64 now = profileNow();
+
+    u64 gpuTime = GpuProfiler::get().getLastFrameTime();
+    if (gpuTime != 0) smooth(gpuFrameTime, gpuTime, SMOOTHING);
+
+    u64 interval = fpsCap > 0.0f ? static_cast<u64>(1e9 / fpsCap) : 0;
+    if (lowLatency) {
+      interval = std::max(interval, static_cast<u64>(gpuFrameTime * (1.0 - HEADROOM)));
+      // We had to wait that long for the GPU last frame, so it would have
+      // been just as fast to start that much later.
+      interval += lastStall;
+    }
+
+    u64 target = frameStart + interval;
+    if (frameStart != 0 && target > now) {
+      u64 remaining = target - now;
+      if (remaining > SPIN_NS) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - SPIN_NS));
+      }
+      while (profileNow() < target) std::this_thread::yield();
+    }
+
+    frameStart = profileNow();
+    lastStall = 0;
+    smooth(sleep, frameStart - now, SMOOTHING);
+    REN_PROFILE_COUNTER("Limiter Sleep (ms)", (frameStart - now) / 1e6);
+  }
+
+
+  void FrameLimiter::addStall(u64 ns) {
+    lastStall += ns;
+    smooth(stall, ns, SMOOTHING);
+    REN_PROFILE_COUNTER("GPU Stall (ms)", ns / 1e6);
+  }
+
+
+  void FrameLimiter::addLatency(u64 ns) {
+    smooth(latency, ns, SMOOTHING);
+    REN_PROFILE_COUNTER("Frame Latency (ms)", ns / 1e6);
+  }
+
+}  // namespace ren
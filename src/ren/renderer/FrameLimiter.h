@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ren/types.h>
+
+namespace ren {
+
+  // Paces the main loop. When the CPU runs ahead of the GPU, every frame waits
+  // in the queue behind the ones before it, and the input it sampled gets
+  // older the whole time. In low latency mode the limiter sleeps that time
+  // off before the frame samples input instead, so each frame starts as late
+  // as it can while still being ready by the time the GPU gets to it.
+  //
+  // Each frame is aimed to start one frame interval after the last: the GPU's
+  // measured frame time (a little less, so the GPU never runs dry), or the
+  // frame cap if that's longer. Whatever the Renderer still spent waiting on
+  // the GPU (or the display) at the start of the frame pushes the next start
+  // back by that much, which drains the queue again.
+  class FrameLimiter {
+   public:
+    FrameLimiter(void) = default;
+
+    // Sleep until the next frame should start. Call right before sampling input.
+    void wait(void);
+
+    // Time the current frame spent blocked on the GPU or the swapchain.
+    void addStall(u64 ns);
+    // A frame finished on the GPU `ns` after it started (after wait() returned).
+    void addLatency(u64 ns);
+
+    // When the current frame started, in profileNow() nanoseconds.
+    u64 getFrameStart(void) const { return frameStart; }
+
+    // Smoothed over the last few dozen frames, in nanoseconds.
+    u64 getSleep(void) const { return static_cast<u64>(sleep); }
+    u64 getStall(void) const { return static_cast<u64>(stall); }
+    u64 getLatency(void) const { return static_cast<u64>(latency); }
+
+    // Sleep away the time frames would otherwise spend queued.
+    bool lowLatency = false;
+    // Never start frames faster than this. 0 is uncapped.
+    float fpsCap = 0.0f;
+
+   private:
+    // sleep_for can overshoot by a scheduler tick, so we spin for the last bit.
+    static constexpr u64 SPIN_NS = 1'000'000;
+    // How much shorter than the GPU's frame time we aim for.
+    static constexpr double HEADROOM = 0.02;
+    // Weight of the newest sample in the smoothed values.
+    static constexpr double SMOOTHING = 0.05;
+
+    u64 frameStart = 0;
+    // The last frame's stall, which the next start is pushed back by.
+    u64 lastStall = 0;
+    double gpuFrameTime = 0.0;
+    double sleep = 0.0;
+    double stall = 0.0;
+    double latency = 0.0;
+  };
+
+}  // namespace ren
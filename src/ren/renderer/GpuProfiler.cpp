@@ -0,0 +1,200 @@
+#include <ren/renderer/GpuProfiler.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/renderer/FrameData.h>
+#include <fmt/core.h>
+
+namespace ren {
+
+  static GpuProfiler *g_gpuProfiler = nullptr;
+  GpuProfiler &GpuProfiler::get(void) {
+    if (g_gpuProfiler == nullptr) { throw std::runtime_error("GpuProfiler not initialized"); }
+    return *g_gpuProfiler;
+  }
+
+
+  GpuProfiler::GpuProfiler(VulkanInstance &vulkan)
+      : vulkan(vulkan) {
+    g_gpuProfiler = this;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vulkan.physical_device, &properties);
+
+    u32 familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vulkan.physical_device, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(vulkan.physical_device, &familyCount,
+                                             families.data());
+
+    u32 validBits = families[vulkan.graphics_queue_family].timestampValidBits;
+    if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+      fmt::println("GPU timestamps are not supported on the graphics queue");
+      return;
+    }
+
+    supported = true;
+    period = properties.limits.timestampPeriod;
+    validMask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+    track = Instrumentor::Get().createTrack("GPU");
+
+    calibrate();
+  }
+
+
+  void GpuProfiler::calibrate(void) {
+    if (!supported) return;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = 1;
+    VkQueryPool pool;
+    VK_CHECK(vkCreateQueryPool(vulkan.device, &poolInfo, nullptr, &pool));
+
+    // Write a timestamp on an otherwise idle queue and assume it landed halfway
+    // between the submit and the wait returning. That is good to within the
+    // submission latency, which is plenty for lining up zones in a trace.
+    auto cmd = vulkan.beginSingleTimeCommands();
+    vkCmdResetQueryPool(cmd, pool, 0, 1);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 0);
+    u64 before = profileNow();
+    vulkan.endSingleTimeCommands(cmd);
+    u64 after = profileNow();
+
+    u64 ticks = 0;
+    VK_CHECK(vkGetQueryPoolResults(vulkan.device, pool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+    vkDestroyQueryPool(vulkan.device, pool, nullptr);
+
+    u64 cpu = before + (after - before) / 2;
+    offset = static_cast<i64>(cpu) - static_cast<i64>(toNanoseconds(ticks & validMask));
+  }
+
+
+  u64 GpuProfiler::toNanoseconds(u64 ticks) const {
+    return static_cast<u64>(static_cast<double>(ticks) * period);
+  }
+
+
+  u64 GpuProfiler::toCpuTime(u64 ticks) const {
+    return static_cast<u64>(static_cast<i64>(toNanoseconds(ticks & validMask)) + offset);
+  }
+
+
+  // ---- GpuQueryPool ---- //
+
+  GpuQueryPool::GpuQueryPool(void) {
+    if (!GpuProfiler::get().isSupported()) return;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_QUERIES;
+    VK_CHECK(vkCreateQueryPool(getVulkan().device, &poolInfo, nullptr, &pool));
+  }
+
+
+  GpuQueryPool::~GpuQueryPool(void) {
+    if (pool != VK_NULL_HANDLE) vkDestroyQueryPool(getVulkan().device, pool, nullptr);
+  }
+
+
+  void GpuQueryPool::reset(VkCommandBuffer cmd) {
+    if (pool == VK_NULL_HANDLE) return;
+    vkCmdResetQueryPool(cmd, pool, 0, MAX_QUERIES);
+    queryCount = 0;
+    zoneCount = 0;
+    pending = true;
+  }
+
+
+  u32 GpuQueryPool::beginZone(VkCommandBuffer cmd, const char *name,
+                              VkPipelineStageFlagBits stage) {
+    if (pool == VK_NULL_HANDLE) return UINT32_MAX;
+
+    u32 zone = zoneCount.fetch_add(1, std::memory_order_relaxed);
+    if (zone >= zones.size()) return UINT32_MAX;
+    u32 query = queryCount.fetch_add(2, std::memory_order_relaxed);
+    if (query + 2 > MAX_QUERIES) {
+      zones[zone] = {name, UINT32_MAX, UINT32_MAX};  // collect() skips it.
+      return UINT32_MAX;
+    }
+
+    zones[zone] = {name, query, query + 1};
+    vkCmdWriteTimestamp(cmd, stage, pool, query);
+    return zone;
+  }
+
+
+  void GpuQueryPool::endZone(VkCommandBuffer cmd, u32 zone, VkPipelineStageFlagBits stage) {
+    if (zone == UINT32_MAX) return;
+    vkCmdWriteTimestamp(cmd, stage, pool, zones[zone].endQuery);
+  }
+
+
+  void GpuQueryPool::collect(void) {
+    if (!pending) return;
+    pending = false;
+
+    u32 count = std::min<u32>(queryCount, MAX_QUERIES);
+    u32 zoneTotal = std::min<u32>(zoneCount, zones.size());
+    if (count == 0) return;
+
+    // Each query comes back as a (value, availability) pair. Queries that never
+    // got written (a zone that wasn't closed, say) are unavailable, which makes
+    // the call return VK_NOT_READY, but every available pair is still valid.
+    std::array<u64, MAX_QUERIES * 2> results;
+    VkResult res = vkGetQueryPoolResults(
+        getVulkan().device, pool, 0, count, sizeof(u64) * 2 * count, results.data(),
+        sizeof(u64) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (res != VK_SUCCESS && res != VK_NOT_READY) return;
+
+    auto &profiler = GpuProfiler::get();
+    u64 frameStart = UINT64_MAX;
+    u64 frameEnd = 0;
+    for (u32 i = 0; i < zoneTotal; i++) {
+      auto &zone = zones[i];
+      if (zone.endQuery >= count) continue;
+      if (results[zone.beginQuery * 2 + 1] == 0 || results[zone.endQuery * 2 + 1] == 0) continue;
+      u64 begin = results[zone.beginQuery * 2] & profiler.getValidMask();
+      u64 end = results[zone.endQuery * 2] & profiler.getValidMask();
+      if (end < begin) continue;  // The counter wrapped.
+
+      TraceEvent event;
+      event.name = zone.name;
+      event.timestamp = profiler.toCpuTime(begin);
+      event.duration = profiler.toNanoseconds(end - begin);
+      event.track = profiler.getTrack();
+      event.type = TraceEventType::Complete;
+      Instrumentor::Get().record(event);
+
+      frameStart = std::min(frameStart, begin);
+      frameEnd = std::max(frameEnd, end);
+    }
+    if (frameEnd > frameStart) {
+      // Tells the live stats that this GPU frame's zones are all in.
+      TraceEvent mark;
+      mark.name = "GPU Frame";
+      mark.timestamp = profiler.toCpuTime(frameEnd);
+      mark.duration = 0;
+      mark.track = profiler.getTrack();
+      mark.type = TraceEventType::Frame;
+      Instrumentor::Get().record(mark);
+
+      profiler.setLastFrame(profiler.toCpuTime(frameEnd),
+                            profiler.toNanoseconds(frameEnd - frameStart));
+    }
+  }
+
+
+  // ---- GpuScope ---- //
+
+  GpuScope::GpuScope(VkCommandBuffer cmd, const char *name)
+      : cmd(cmd) {
+    queries = getFrameData().queries.get();
+    zone = queries->beginZone(cmd, name);
+  }
+
+
+  GpuScope::~GpuScope(void) { queries->endZone(cmd, zone); }
+
+}  // namespace ren
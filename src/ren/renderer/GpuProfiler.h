@@ -0,0 +1,132 @@
+#pragma once
+
+#include <ren/types.h>
+#include <ren/core/Instrumentation.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // A GPU zone is a pair of timestamps written into a command buffer.
+  struct GpuZone {
+    const char *name;
+    u32 beginQuery;
+    u32 endQuery;
+  };
+
+
+  // The timestamp queries for one FrameData. Zones are written while the
+  // frame's command buffer is recorded, and read back once the frame has
+  // finished on the GPU (so vkGetQueryPoolResults never has to wait).
+  class GpuQueryPool {
+   public:
+    static constexpr u32 MAX_QUERIES = 256;
+
+    GpuQueryPool(void);
+    ~GpuQueryPool(void);
+
+    GpuQueryPool(const GpuQueryPool &) = delete;
+    GpuQueryPool &operator=(const GpuQueryPool &) = delete;
+
+    // Must be recorded outside of a render pass, before any zones.
+    void reset(VkCommandBuffer cmd);
+
+    // Returns the zone index to pass to endZone, or UINT32_MAX if we ran out of queries.
+    u32 beginZone(VkCommandBuffer cmd, const char *name,
+                  VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void endZone(VkCommandBuffer cmd, u32 zone,
+                 VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    // Read back last submission's results and emit them onto the GPU track.
+    // Only call this once the frame has finished on the GPU.
+    void collect(void);
+
+   private:
+    VkQueryPool pool = VK_NULL_HANDLE;
+    // Zones can be opened from more than one recording thread.
+    std::atomic<u32> queryCount = 0;
+    std::atomic<u32> zoneCount = 0;
+    std::array<GpuZone, MAX_QUERIES / 2> zones;
+    // Did we record queries that haven't been read back yet?
+    bool pending = false;
+  };
+
+
+  // Device-wide state for GPU timing: the tick period and the offset that
+  // maps GPU timestamps onto the CPU's profileNow() clock.
+  class GpuProfiler {
+   public:
+    GpuProfiler(VulkanInstance &vulkan);
+
+    static GpuProfiler &get(void);
+
+    bool isSupported(void) const { return supported; }
+
+    // Re-measure the GPU clock against the CPU clock. This waits for the
+    // graphics queue, so only call it when we're already stalled.
+    void calibrate(void);
+
+    // Convert a raw timestamp query value into profileNow() nanoseconds.
+    u64 toCpuTime(u64 ticks) const;
+    u64 toNanoseconds(u64 ticks) const;
+
+    u64 getValidMask(void) const { return validMask; }
+    u32 getTrack(void) const { return track; }
+
+    // How long the GPU spent on the last collected frame, in nanoseconds.
+    u64 getLastFrameTime(void) const { return lastFrameTime; }
+    // When the GPU finished the last collected frame, in profileNow() nanoseconds.
+    u64 getLastFrameEnd(void) const { return lastFrameEnd; }
+    void setLastFrame(u64 end, u64 duration) {
+      lastFrameEnd = end;
+      lastFrameTime = duration;
+      if (keepFrameTimes) frameTimes.push_back(duration);
+    }
+
+    // Queue up every collected frame's GPU time until takeFrameTimes(), for
+    // callers that need each GPU frame exactly once rather than the latest.
+    void setKeepFrameTimes(bool keep) {
+      keepFrameTimes = keep;
+      if (!keep) frameTimes.clear();
+    }
+    // The GPU times (ns) of the frames collected since the last call, oldest first.
+    std::vector<u64> takeFrameTimes(void) { return std::exchange(frameTimes, {}); }
+
+   private:
+    VulkanInstance &vulkan;
+    bool supported = false;
+    double period = 1.0;  // nanoseconds per tick
+    u64 validMask = ~0ULL;
+    i64 offset = 0;  // cpu ns - gpu ns
+    u32 track = 0;
+    u64 lastFrameTime = 0;
+    u64 lastFrameEnd = 0;
+    bool keepFrameTimes = false;
+    std::vector<u64> frameTimes;
+  };
+
+
+  // RAII helper behind REN_GPU_SCOPE. Writes into the current frame's queries.
+  class GpuScope {
+   public:
+    GpuScope(VkCommandBuffer cmd, const char *name);
+    ~GpuScope(void);
+
+   private:
+    VkCommandBuffer cmd;
+    GpuQueryPool *queries;
+    u32 zone;
+  };
+}  // namespace ren
+
+
+#ifdef REN_PROFILE
+  #define REN_GPU_SCOPE_LINE2(cmd, name, line) ::ren::GpuScope gpuScope##line(cmd, name)
+  #define REN_GPU_SCOPE_LINE(cmd, name, line) REN_GPU_SCOPE_LINE2(cmd, name, line)
+  #define REN_GPU_SCOPE(cmd, name) REN_GPU_SCOPE_LINE(cmd, name, __LINE__)
+#else
+  #define REN_GPU_SCOPE(cmd, name)
+#endif
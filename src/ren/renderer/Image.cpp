@@ -20,6 +20,8 @@ namespace ren {
   Image::~Image(void) {
     s_images.erase(this);
     auto &vulkan = ren::getVulkan();
+    // The view's handle could be reused, so no cached set may point at it.
+    DescriptorCache::forget((u64)imageView);
 
     // If an Image has no memory, it means it is managed elsewhere and we should not actually
     // destroy it here. (e.g., swapchain images)
@@ -27,9 +29,12 @@ namespace ren {
 
 
     if (image != VK_NULL_HANDLE) {
-      vkDestroyImageView(vulkan.device, imageView, nullptr);
-
-      vmaDestroyImage(vulkan.allocator, image, memory);
+      // Frames in flight may still be using it.
+      DeletionQueue::defer([device = vulkan.device, allocator = vulkan.allocator, image = image,
+                            imageView = imageView, memory = memory] {
+        vkDestroyImageView(device, imageView, nullptr);
+        vmaDestroyImage(allocator, image, memory);
+      });
     }
   }
 
@@ -71,8 +76,9 @@ namespace ren {
     viewInfo.subresourceRange.layerCount = 1;
 
     // same with the allocation create info.
+    // Sub-allocated, unless build() finds it's an attachment.
     allocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;  // Ensure dedicated memory
+    allocCreateInfo.flags = 0;
   }
 
   Image::Ref ImageBuilder::build(void) {
@@ -81,6 +87,15 @@ namespace ren {
     VmaAllocation memory;  // TODO:
     VkImageView imageView;
 
+    // Render targets are big, and are recreated all at once when the window
+    // resizes, so they get memory of their own rather than leaving holes in
+    // shared blocks. VMA also goes dedicated by itself when the driver asks.
+    constexpr VkImageUsageFlags attachmentUsage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (imageInfo.usage & attachmentUsage) {
+      allocCreateInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    }
+
     VmaAllocationInfo allocInfo = {};
     vmaCreateImage(vulkan.allocator, &imageInfo, &allocCreateInfo, &image, &memory, &allocInfo);
 
@@ -45,6 +45,9 @@ namespace ren {
     u32 getHeight(void) const { return imageCreateInfo.extent.height; }
     u32 getDepth(void) const { return imageCreateInfo.extent.depth; }
 
+    // Is the image owned by something else (like the swapchain)?
+    bool isExternal(void) const { return memory == VK_NULL_HANDLE; }
+
    private:
     std::string name;
     VkImage image = VK_NULL_HANDLE;
@@ -0,0 +1,126 @@
+#include <ren/renderer/LayoutCache.h>
+#include <ren/renderer/Vulkan.h>
+#include <algorithm>
+
+namespace ren {
+
+  LayoutCache::LayoutCache(VulkanInstance &vulkan)
+      : vulkan(vulkan) {}
+
+
+  LayoutCache::~LayoutCache(void) {
+    for (auto &[key, layout] : pipelineLayouts) {
+      vkDestroyPipelineLayout(vulkan.device, layout, nullptr);
+    }
+    for (auto &[key, layout] : setLayouts) {
+      vkDestroyDescriptorSetLayout(vulkan.device, layout, nullptr);
+    }
+  }
+
+
+  VkDescriptorSetLayout LayoutCache::getSetLayout(
+      std::vector<VkDescriptorSetLayoutBinding> bindings) {
+    std::sort(bindings.begin(), bindings.end(),
+              [](auto &a, auto &b) { return a.binding < b.binding; });
+    SetKey key{std::move(bindings)};
+
+    std::lock_guard lock(mutex);
+    auto it = setLayouts.find(key);
+    if (it != setLayouts.end()) return it->second;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<u32>(key.bindings.size());
+    layoutInfo.pBindings = key.bindings.data();
+
+    VkDescriptorSetLayout layout;
+    VK_CHECK(vkCreateDescriptorSetLayout(vulkan.device, &layoutInfo, nullptr, &layout));
+    setLayouts.emplace(std::move(key), layout);
+    return layout;
+  }
+
+
+  VkPipelineLayout LayoutCache::getPipelineLayout(
+      const std::vector<VkDescriptorSetLayout> &sets,
+      const std::vector<VkPushConstantRange> &pushConstants) {
+    PipelineKey key{sets, pushConstants};
+
+    std::lock_guard lock(mutex);
+    auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end()) return it->second;
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = static_cast<u32>(sets.size());
+    layoutInfo.pSetLayouts = sets.data();
+    layoutInfo.pushConstantRangeCount = static_cast<u32>(pushConstants.size());
+    layoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkPipelineLayout layout;
+    VK_CHECK(vkCreatePipelineLayout(vulkan.device, &layoutInfo, nullptr, &layout));
+    pipelineLayouts.emplace(std::move(key), layout);
+    return layout;
+  }
+
+
+  size_t LayoutCache::getSetLayoutCount(void) const {
+    std::lock_guard lock(mutex);
+    return setLayouts.size();
+  }
+
+
+  size_t LayoutCache::getPipelineLayoutCount(void) const {
+    std::lock_guard lock(mutex);
+    return pipelineLayouts.size();
+  }
+
+
+  bool LayoutCache::SetKey::operator==(const SetKey &other) const {
+    return std::equal(bindings.begin(), bindings.end(), other.bindings.begin(),
+                      other.bindings.end(), [](auto &a, auto &b) {
+                        return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+                               a.descriptorCount == b.descriptorCount &&
+                               a.stageFlags == b.stageFlags;
+                      });
+  }
+
+
+  bool LayoutCache::PipelineKey::operator==(const PipelineKey &other) const {
+    return setLayouts == other.setLayouts &&
+           std::equal(pushConstants.begin(), pushConstants.end(), other.pushConstants.begin(),
+                      other.pushConstants.end(), [](auto &a, auto &b) {
+                        return a.stageFlags == b.stageFlags && a.offset == b.offset &&
+                               a.size == b.size;
+                      });
+  }
+
+
+  static void hashCombine(size_t &seed, u64 value) {
+    seed ^= std::hash<u64>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+  }
+
+
+  size_t LayoutCache::KeyHash::operator()(const SetKey &key) const {
+    size_t seed = key.bindings.size();
+    for (auto &binding : key.bindings) {
+      hashCombine(seed, binding.binding);
+      hashCombine(seed, binding.descriptorType);
+      hashCombine(seed, binding.descriptorCount);
+      hashCombine(seed, binding.stageFlags);
+    }
+    return seed;
+  }
+
+
+  size_t LayoutCache::KeyHash::operator()(const PipelineKey &key) const {
+    size_t seed = key.setLayouts.size();
+    for (auto layout : key.setLayouts) hashCombine(seed, (u64)layout);
+    for (auto &range : key.pushConstants) {
+      hashCombine(seed, range.stageFlags);
+      hashCombine(seed, range.offset);
+      hashCombine(seed, range.size);
+    }
+    return seed;
+  }
+
+}  // namespace ren
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ren/types.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // Descriptor set layouts and pipeline layouts, deduplicated. Pipelines ask
+  // for the layouts their shaders' reflection describes, so two pipelines
+  // whose shaders declare the same sets and push constants end up with the
+  // very same VkPipelineLayout. Sets bound for one stay bound (and valid)
+  // for the other, and nobody writes a layout by hand.
+  //
+  // Layouts live as long as the cache (which VulkanInstance owns), so
+  // pipelines never destroy theirs. Thread safe.
+  class LayoutCache {
+   public:
+    LayoutCache(VulkanInstance &vulkan);
+    // Destroys every layout. Nothing may still be using them.
+    ~LayoutCache(void);
+
+    LayoutCache(const LayoutCache &) = delete;
+    LayoutCache &operator=(const LayoutCache &) = delete;
+
+    // The layout for these bindings, in any order. No immutable samplers.
+    VkDescriptorSetLayout getSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+    VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                       const std::vector<VkPushConstantRange> &pushConstants);
+
+    size_t getSetLayoutCount(void) const;
+    size_t getPipelineLayoutCount(void) const;
+
+   private:
+    struct SetKey {
+      std::vector<VkDescriptorSetLayoutBinding> bindings;
+      bool operator==(const SetKey &other) const;
+    };
+    struct PipelineKey {
+      std::vector<VkDescriptorSetLayout> setLayouts;
+      std::vector<VkPushConstantRange> pushConstants;
+      bool operator==(const PipelineKey &other) const;
+    };
+    struct KeyHash {
+      size_t operator()(const SetKey &key) const;
+      size_t operator()(const PipelineKey &key) const;
+    };
+
+    VulkanInstance &vulkan;
+    mutable std::mutex mutex;
+    std::unordered_map<SetKey, VkDescriptorSetLayout, KeyHash> setLayouts;
+    std::unordered_map<PipelineKey, VkPipelineLayout, KeyHash> pipelineLayouts;
+  };
+
+}  // namespace ren
@@ -0,0 +1,171 @@
+#include <ren/renderer/MemoryPools.h>
+#include <ren/renderer/Vulkan.h>
+
+namespace ren {
+
+  // How big each category's blocks are. Buffers over half a block skip the
+  // pool: they'd waste most of a block of their own anyway.
+  static constexpr VkDeviceSize BLOCK_SIZES[MemoryPools::CATEGORY_COUNT] = {
+      64 * 1024 * 1024,  // Static
+      16 * 1024 * 1024,  // Dynamic
+      32 * 1024 * 1024,  // Staging
+  };
+
+  // Every usage a buffer in the category may have. The spec guarantees a
+  // buffer's memoryTypeBits only grow as its usage shrinks, so a memory type
+  // that works for all of these works for any buffer using a subset of them.
+  static constexpr VkBufferUsageFlags GEOMETRY_USAGE =
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  static constexpr VkBufferUsageFlags POOL_USAGES[MemoryPools::CATEGORY_COUNT] = {
+      GEOMETRY_USAGE,
+      GEOMETRY_USAGE,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  };
+
+
+  MemoryPools::MemoryPools(VulkanInstance &vulkan, bool directWrites)
+      : vulkan(vulkan) {
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkan.allocator, &memoryProperties);
+    staticHostVisible = directWrites && hasHostVisibleVram();
+
+    for (u32 i = 0; i < CATEGORY_COUNT; i++) {
+      auto category = static_cast<MemoryCategory>(i);
+
+      VkBufferCreateInfo bufferInfo{};
+      bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+      bufferInfo.size = 1024;
+      bufferInfo.usage = POOL_USAGES[i];
+      bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      VmaAllocationCreateInfo allocInfo = getCategoryAllocation(category);
+      if (vmaFindMemoryTypeIndexForBufferInfo(vulkan.allocator, &bufferInfo, &allocInfo,
+                                              &memoryTypes[i]) != VK_SUCCESS) {
+        throw std::runtime_error(
+            fmt::format("No memory type for {} buffers", getCategoryName(category)));
+      }
+
+      VmaPoolCreateInfo poolInfo = {};
+      poolInfo.memoryTypeIndex = memoryTypes[i];
+      poolInfo.blockSize = getBlockSize(category);
+      if (vmaCreatePool(vulkan.allocator, &poolInfo, &pools[i]) != VK_SUCCESS) {
+        throw std::runtime_error(
+            fmt::format("Failed to create the {} memory pool", getCategoryName(category)));
+      }
+      vmaSetPoolName(vulkan.allocator, pools[i], getCategoryName(category));
+
+      u32 heap = memoryProperties->memoryTypes[memoryTypes[i]].heapIndex;
+      fmt::print("{} buffers: memory type {} (heap {}), {}MB blocks\n", getCategoryName(category),
+                 memoryTypes[i], heap, poolInfo.blockSize / (1024 * 1024));
+    }
+    if (staticHostVisible) fmt::print("Static buffers are written directly\n");
+  }
+
+
+  MemoryPools::~MemoryPools(void) {
+    for (auto pool : pools) {
+      if (pool != VK_NULL_HANDLE) vmaDestroyPool(vulkan.allocator, pool);
+    }
+  }
+
+
+  const char *MemoryPools::getCategoryName(MemoryCategory category) {
+    switch (category) {
+      case MemoryCategory::Static: return "Static";
+      case MemoryCategory::Dynamic: return "Dynamic";
+      case MemoryCategory::Staging: return "Staging";
+      default: return "Unknown";
+    }
+  }
+
+
+  MemoryCategory MemoryPools::categorize(VkBufferUsageFlags usage,
+                                         VkMemoryPropertyFlags properties) {
+    if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) return MemoryCategory::Static;
+    if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return MemoryCategory::Staging;
+    return MemoryCategory::Dynamic;
+  }
+
+
+  bool MemoryPools::hasHostVisibleVram(void) const {
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkan.allocator, &memoryProperties);
+
+    VkDeviceSize largest = 0;
+    for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+      auto &heap = memoryProperties->memoryHeaps[i];
+      if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) largest = std::max(largest, heap.size);
+    }
+
+    constexpr VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (u32 i = 0; i < memoryProperties->memoryTypeCount; i++) {
+      auto &type = memoryProperties->memoryTypes[i];
+      if ((type.propertyFlags & wanted) != wanted) continue;
+      if (memoryProperties->memoryHeaps[type.heapIndex].size >= largest) return true;
+    }
+    return false;
+  }
+
+
+  VmaAllocationCreateInfo MemoryPools::getCategoryAllocation(MemoryCategory category) const {
+    VmaAllocationCreateInfo info = {};
+    switch (category) {
+      case MemoryCategory::Static:
+        info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        if (staticHostVisible) {
+          info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+          info.requiredFlags |=
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+        break;
+      case MemoryCategory::Dynamic:
+        info.usage = VMA_MEMORY_USAGE_AUTO;
+        info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        info.requiredFlags =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        break;
+      default:
+        info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+        info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        info.requiredFlags =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        break;
+    }
+    return info;
+  }
+
+
+  VmaAllocationCreateInfo MemoryPools::getBufferAllocation(MemoryCategory category,
+                                                           VkBufferUsageFlags usage,
+                                                           VkDeviceSize size) const {
+    VmaAllocationCreateInfo info = getCategoryAllocation(category);
+    if (size <= getBlockSize(category) / 2 && (usage & ~POOL_USAGES[index(category)]) == 0) {
+      info.pool = pools[index(category)];
+    }
+    return info;
+  }
+
+
+  VkDeviceSize MemoryPools::getBlockSize(MemoryCategory category) const {
+    // Small heaps (like the 256MB of host visible VRAM without resizable BAR)
+    // get smaller blocks, so one pool can't take a big bite out of them.
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkan.allocator, &memoryProperties);
+    u32 heap = memoryProperties->memoryTypes[memoryTypes[index(category)]].heapIndex;
+    return std::min(BLOCK_SIZES[index(category)], memoryProperties->memoryHeaps[heap].size / 8);
+  }
+
+
+  VmaStatistics MemoryPools::getStatistics(MemoryCategory category) const {
+    VmaStatistics stats = {};
+    vmaGetPoolStatistics(vulkan.allocator, pools[index(category)], &stats);
+    return stats;
+  }
+
+}  // namespace ren
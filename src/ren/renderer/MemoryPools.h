@@ -0,0 +1,87 @@
+#pragma once
+
+#include <ren/types.h>
+#include <vulkan/vulkan_core.h>
+#include <vk_mem_alloc.h>
+#include <array>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // What a buffer's memory is for. Each category is sub-allocated from a VMA
+  // pool of its own, so small buffers share a few large VkDeviceMemory blocks
+  // (instead of each using up one of the driver's maxMemoryAllocationCount)
+  // and buffers that live for very different lengths of time don't fragment
+  // each other's blocks.
+  enum class MemoryCategory : u8 {
+    // Device local, written once and read by the GPU from then on: meshes,
+    // particle state, anything long lived. Filled through the UploadQueue,
+    // or written in place if the pool's memory is host visible too (see
+    // MemoryPools::isStaticHostVisible()).
+    Static,
+    // Host visible and coherent, rewritten by the CPU every frame or so:
+    // uniforms, streamed vertices. Device local as well when the device has
+    // memory that is both (resizable BAR, integrated GPUs).
+    Dynamic,
+    // Host visible and coherent, only ever the source of transfers.
+    Staging,
+    COUNT,
+  };
+
+
+  // The VMA pool for each MemoryCategory. Images aren't pooled by category:
+  // they come out of VMA's default pools, except attachments, which get
+  // dedicated memory (see ImageBuilder).
+  class MemoryPools {
+   public:
+    static constexpr u32 CATEGORY_COUNT = static_cast<u32>(MemoryCategory::COUNT);
+
+    // Needs the allocator, so it's created right after it. With
+    // `directWrites`, Static buffers go in memory that is both device local
+    // and host visible when there's a whole heap of it (resizable BAR, or an
+    // integrated GPU), and are written without staging. Not when it's just
+    // the small BAR window: that's better spent on Dynamic buffers.
+    MemoryPools(VulkanInstance &vulkan, bool directWrites);
+    // Every allocation from the pools must already be gone.
+    ~MemoryPools(void);
+
+    MemoryPools(const MemoryPools &) = delete;
+    MemoryPools &operator=(const MemoryPools &) = delete;
+
+    static const char *getCategoryName(MemoryCategory category);
+    // Which category a buffer with this usage and these (preferred) memory
+    // properties belongs in.
+    static MemoryCategory categorize(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+
+    // How to allocate a `size` byte buffer with `usage` in `category`. This
+    // is the category's pool, unless the buffer is too big to share a block
+    // or uses something the pool's memory type wasn't chosen for. Then it's
+    // a plain allocation with the same requirements, which VMA may make
+    // dedicated.
+    VmaAllocationCreateInfo getBufferAllocation(MemoryCategory category, VkBufferUsageFlags usage,
+                                                VkDeviceSize size) const;
+
+    VmaPool getPool(MemoryCategory category) const { return pools[index(category)]; }
+    u32 getMemoryTypeIndex(MemoryCategory category) const {
+      return memoryTypes[index(category)];
+    }
+    VkDeviceSize getBlockSize(MemoryCategory category) const;
+    // Whether Static buffers can be mapped and written directly.
+    bool isStaticHostVisible(void) const { return staticHostVisible; }
+    // Blocks and allocations in the category's pool. Cheap enough to call every frame.
+    VmaStatistics getStatistics(MemoryCategory category) const;
+
+   private:
+    static u32 index(MemoryCategory category) { return static_cast<u32>(category); }
+    VmaAllocationCreateInfo getCategoryAllocation(MemoryCategory category) const;
+    // Is there a device local, host visible memory type on the biggest device local heap?
+    bool hasHostVisibleVram(void) const;
+
+    VulkanInstance &vulkan;
+    bool staticHostVisible = false;
+    std::array<VmaPool, CATEGORY_COUNT> pools = {};
+    std::array<u32, CATEGORY_COUNT> memoryTypes = {};
+  };
+
+}  // namespace ren
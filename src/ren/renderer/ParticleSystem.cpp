@@ -0,0 +1,93 @@
+#include <ren/renderer/ParticleSystem.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/renderer/Renderer.h>
+#include <ren/core/Instrumentation.h>
+
+namespace ren {
+
+  ParticleSystem::ParticleSystem(u32 count)
+      : count(count) {
+    REN_PROFILE_FUNCTION();
+    auto &vulkan = ren::getVulkan();
+
+    u32 bufferCount = std::max<u32>(Renderer::get().getFrameCount(), 2);
+    for (u32 i = 0; i < bufferCount; i++) {
+      auto buffer = makeBox<Buffer>(vulkan, count * sizeof(Particle),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      buffer->setName(fmt::format("Particles #{}", i));
+      states.push_back(std::move(buffer));
+    }
+
+    // ---- Pipelines ---- //
+    // Their layouts are reflected from the shaders. Compute reads the
+    // previous state (binding 0) and writes the next (binding 1), the points
+    // read the state at binding 0.
+    computePipeline = makeBox<ComputePipeline>("shaders/particles.comp.spv");
+    pointPipeline = makeBox<PointPipeline>();
+    VkDescriptorSetLayout computeLayout = computePipeline->getSetLayout(0);
+    VkDescriptorSetLayout drawLayout = pointPipeline->getSetLayout(0);
+
+    // ---- Descriptor sets ---- //
+    // The cache drops them when the state buffers are destroyed.
+    auto &cache = DescriptorCache::get();
+    for (u32 i = 0; i < bufferCount; i++) {
+      VkBuffer previous = states[(i + bufferCount - 1) % bufferCount]->getHandle();
+      VkBuffer next = states[i]->getHandle();
+      computeSets.push_back(cache.getSet(
+          computeLayout, DescriptorBindings()
+                             .buffer(0, previous, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+                             .buffer(1, next, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)));
+      drawSets.push_back(cache.getSet(
+          drawLayout, DescriptorBindings().buffer(0, next, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)));
+    }
+  }
+
+
+  ParticleSystem::~ParticleSystem(void) {
+    computePipeline.reset();
+    pointPipeline.reset();
+    states.clear();
+  }
+
+
+  void ParticleSystem::simulate(VkCommandBuffer cmd, float deltaTime) {
+    REN_PROFILE_FUNCTION();
+    // The buffer we're about to write was last drawn `states.size()` frames
+    // ago, which is only finished if there are no more frames in flight than that.
+    if (Renderer::get().getFrameCount() > states.size()) {
+      throw std::runtime_error("ParticleSystem has fewer state buffers than frames in flight");
+    }
+
+    current = (current + 1) % states.size();
+
+    SimulatePushConstants constants{};
+    constants.count = count;
+    constants.seed = seeded ? 0 : 1;
+    constants.deltaTime = deltaTime;
+    seeded = true;
+
+    computePipeline->bind(cmd);
+    computePipeline->bindDescriptorSet(cmd, computeSets[current]);
+    computePipeline->pushConstants(cmd, constants);
+    computePipeline->dispatchFor(cmd, count, GROUP_SIZE);
+  }
+
+
+  void ParticleSystem::draw(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &proj) {
+    // Nothing has been written until the first step.
+    if (!seeded) return;
+
+    bind(cmd, *pointPipeline);
+    pointPipeline->bindDescriptorSet(cmd, drawSets[current]);
+
+    MeshPushConstants pushConstants{};
+    pushConstants.model = glm::mat4(1.0f);
+    pushConstants.view = view;
+    pushConstants.proj = proj;
+    pointPipeline->pushConstants(cmd, pushConstants);
+
+    vkCmdDraw(cmd, count, 1, 0, 0);
+  }
+
+}  // namespace ren
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <ren/types.h>
+#include <ren/renderer/Buffer.h>
+#include <ren/renderer/pipelines/ComputePipeline.h>
+#include <ren/renderer/pipelines/PointPipeline.h>
+
+namespace ren {
+
+  // One particle, laid out the way particles.comp and point.vert read it (std430).
+  struct Particle {
+    glm::vec4 position;  // w is unused
+    glm::vec4 velocity;  // w is unused
+  };
+
+
+  // A particle cloud that lives entirely on the GPU. Each frame a compute
+  // shader integrates last frame's state buffer into this frame's, and the
+  // PointPipeline draws this frame's straight out of the storage buffer.
+  // Even the initial state is generated on the GPU, so nothing is ever uploaded.
+  //
+  // There is one state buffer per frame in flight (so with two frames in
+  // flight it's plain double buffering). A buffer is only rewritten once the
+  // frame that drew it has finished.
+  class ParticleSystem {
+   public:
+    // Must match local_size_x in particles.comp.
+    static constexpr u32 GROUP_SIZE = 256;
+
+    ParticleSystem(u32 count);
+    ~ParticleSystem(void);
+
+    ParticleSystem(const ParticleSystem &) = delete;
+    ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+    // Record one step into the frame's compute command buffer (see
+    // Renderer::beginCompute). At most once a frame.
+    void simulate(VkCommandBuffer cmd, float deltaTime);
+    // Record the points into a secondary from Renderer::beginCommands.
+    void draw(VkCommandBuffer cmd, const glm::mat4 &view, const glm::mat4 &proj);
+
+    u32 getCount(void) const { return count; }
+
+   private:
+    struct SimulatePushConstants {
+      u32 count;
+      u32 seed;
+      float deltaTime;
+    };
+
+    u32 count;
+    std::vector<box<Buffer>> states;
+    // The state buffer the last simulate() wrote, and draw() reads.
+    u32 current = 0;
+    bool seeded = false;
+
+    // From the DescriptorCache. Indexed by the state buffer being written
+    // (for compute) or read (for draw).
+    std::vector<VkDescriptorSet> computeSets;
+    std::vector<VkDescriptorSet> drawSets;
+
+    box<ComputePipeline> computePipeline;
+    box<PointPipeline> pointPipeline;
+  };
+
+}  // namespace ren
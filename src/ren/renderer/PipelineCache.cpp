@@ -0,0 +1,129 @@
+#include <ren/renderer/PipelineCache.h>
+#include <ren/renderer/Vulkan.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace ren {
+
+  PipelineCache::PipelineCache(VulkanInstance &vulkan, const std::string &path)
+      : vulkan(vulkan)
+      , path(path) {
+    vkGetPhysicalDeviceProperties(vulkan.physical_device, &properties);
+    auto data = load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+    VK_CHECK(vkCreatePipelineCache(vulkan.device, &cacheInfo, nullptr, &cache));
+  }
+
+
+  PipelineCache::~PipelineCache(void) {
+    save();
+    vkDestroyPipelineCache(vulkan.device, cache, nullptr);
+  }
+
+
+  std::vector<u8> PipelineCache::load(void) const {
+    if (path.empty()) return {};
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return {};
+
+    auto size = static_cast<u64>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    FileHeader header{};
+    if (size < sizeof(header) || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+      fmt::print("Pipeline cache {} is truncated, starting empty\n", path);
+      return {};
+    }
+
+    FileHeader expected = makeHeader({});
+    if (header.magic != expected.magic || header.version != expected.version) {
+      fmt::print("{} is not a pipeline cache we wrote, starting empty\n", path);
+      return {};
+    }
+    if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0) {
+      fmt::print("Pipeline cache {} is from another device or driver, starting empty\n", path);
+      return {};
+    }
+    if (header.dataSize != size - sizeof(header)) {
+      fmt::print("Pipeline cache {} is truncated, starting empty\n", path);
+      return {};
+    }
+
+    std::vector<u8> data(header.dataSize);
+    if (!file.read(reinterpret_cast<char *>(data.data()), data.size()) ||
+        hash(data) != header.dataHash) {
+      fmt::print("Pipeline cache {} is corrupt, starting empty\n", path);
+      return {};
+    }
+    fmt::print("Loaded {} bytes of pipeline cache from {}\n", data.size(), path);
+    return data;
+  }
+
+
+  void PipelineCache::save(void) {
+    REN_PROFILE_FUNCTION();
+    if (path.empty() || cache == VK_NULL_HANDLE) return;
+
+    size_t size = 0;
+    VK_CHECK(vkGetPipelineCacheData(vulkan.device, cache, &size, nullptr));
+    std::vector<u8> data(size);
+    VK_CHECK(vkGetPipelineCacheData(vulkan.device, cache, &size, data.data()));
+    data.resize(size);
+    FileHeader header = makeHeader(data);
+
+    std::string temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char *>(data.data()), data.size());
+      file.close();
+      if (!file) {
+        fmt::print("Failed to write the pipeline cache to {}\n", temporary);
+        std::error_code error;
+        std::filesystem::remove(temporary, error);
+        return;
+      }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      fmt::print("Failed to replace {}: {}\n", path, error.message());
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+    fmt::print("Saved {} bytes of pipeline cache to {}\n", data.size(), path);
+  }
+
+
+  PipelineCache::FileHeader PipelineCache::makeHeader(const std::vector<u8> &data) const {
+    FileHeader header{};
+    header.magic = MAGIC;
+    header.version = FILE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.dataHash = hash(data);
+    return header;
+  }
+
+
+  u64 PipelineCache::hash(const std::vector<u8> &data) {
+    // FNV-1a. Only has to catch corruption, not tampering.
+    u64 hash = 0xcbf29ce484222325ull;
+    for (u8 byte : data) {
+      hash ^= byte;
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+}  // namespace ren
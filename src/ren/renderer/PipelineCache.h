@@ -0,0 +1,63 @@
+#pragma once
+
+#include <ren/types.h>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // The process wide VkPipelineCache, kept on disk between runs so the driver
+  // doesn't compile every pipeline from scratch at every start. Every
+  // vkCreate*Pipelines call should pass getHandle().
+  //
+  // The file starts with our own header: the device's vendor, device ID,
+  // driver version and pipelineCacheUUID, plus the size and a hash of the
+  // data. A file from another GPU or driver, or a truncated or corrupt one,
+  // is ignored rather than handed to the driver (which not every driver
+  // survives), and the cache starts empty.
+  class PipelineCache {
+   public:
+    // Load the cache from `path` if it's valid. An empty path keeps the cache
+    // in memory only.
+    PipelineCache(VulkanInstance &vulkan, const std::string &path);
+    // Saves, then destroys the cache.
+    ~PipelineCache(void);
+
+    PipelineCache(const PipelineCache &) = delete;
+    PipelineCache &operator=(const PipelineCache &) = delete;
+
+    VkPipelineCache getHandle(void) const { return cache; }
+
+    // Write the cache to `path`, atomically: into a temporary file that is
+    // then renamed over the old one, so a crash can't leave half a file. A
+    // failure is only reported, the cache is just a speedup.
+    void save(void);
+
+   private:
+    struct FileHeader {
+      u32 magic;
+      u32 version;
+      u32 vendorID;
+      u32 deviceID;
+      u32 driverVersion;
+      u8 uuid[VK_UUID_SIZE];
+      u64 dataSize;
+      u64 dataHash;
+    };
+
+    // 'RPCH', and bumped whenever FileHeader changes.
+    static constexpr u32 MAGIC = 0x48435052;
+    static constexpr u32 FILE_VERSION = 1;
+
+    // The data in the file at `path`, or nothing if it's missing or invalid.
+    std::vector<u8> load(void) const;
+    FileHeader makeHeader(const std::vector<u8> &data) const;
+    static u64 hash(const std::vector<u8> &data);
+
+    VulkanInstance &vulkan;
+    std::string path;
+    VkPhysicalDeviceProperties properties;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+  };
+
+}  // namespace ren
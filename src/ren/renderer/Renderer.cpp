@@ -1,4 +1,7 @@
 #include <ren/renderer/Renderer.h>
+#include <ren/core/JobSystem.h>
+#include <ren/core/Application.h>
+#include <algorithm>
 
 
 
@@ -7,26 +10,64 @@ namespace ren {
 
 
   static Renderer *g_renderer = nullptr;
+  static FrameData *g_frameData = nullptr;
   Renderer &Renderer::get(void) {
     if (g_renderer == nullptr) { throw std::runtime_error("Renderer not initialized"); }
     return *g_renderer;
   }
 
 
-  Renderer::Renderer(SDL_Window *window)
-      : window(window) {
+  FrameData &getFrameData(void) {
+    if (!g_frameData) {
+      throw std::runtime_error("Frame data not initialized. Call Renderer::beginFrame() first.");
+    }
+    return *g_frameData;
+  }
+
+
+  Renderer::Renderer(SDL_Window *window, VkExtent2D headlessExtent)
+      : window(window)
+      , headlessExtent(headlessExtent) {
     REN_PROFILE_FUNCTION();
 
     g_renderer = this;
 
     // Create the Vulkan instance
-    this->vulkan = makeRef<VulkanInstance>(this->window);
+    auto &config = Application::get().getConfig();
+    this->vulkan = makeRef<VulkanInstance>(this->window, headlessExtent, config.directWrites,
+                                           config.pipelineCachePath);
+    // Before anything that might defer its destruction.
+    this->deletions = makeBox<DeletionQueue>(*this->vulkan);
+    this->descriptorCache = makeBox<DescriptorCache>(*this->vulkan);
+    // Before any Texture, since they register themselves.
+    this->bindless = makeBox<BindlessTextures>(*this->vulkan);
+    // The GPU profiler has to exist before the frames, since each frame owns a query pool.
+    this->gpuProfiler = makeBox<GpuProfiler>(*this->vulkan);
+    this->uploads = makeBox<UploadQueue>(*this->vulkan);
+    this->transient = makeBox<DynamicBuffer<u8>>(
+        *this->vulkan, TRANSIENT_BYTES,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    this->transient->setName("Transient Buffer");
     // Create the render pass.
     this->renderPass = makeRef<ren::RenderPass>();
     this->renderPass->build();
 
     fmt::println("Render Pass created with handle: {}", (void *)this->renderPass.get());
 
+    // Fewer frames in flight means less latency, more means the CPU and GPU
+    // stall on each other less. The headless swapchain sizes itself from
+    // this, so the frames come first.
+    u32 framesInFlight = std::clamp<u32>(config.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    for (u32 i = 0; i < framesInFlight; i++) {
+      this->frames.push_back(makeBox<FrameData>(i));
+    }
+    fmt::println("Rendering with {} frames in flight", framesInFlight);
+
+    this->presentMode = config.presentMode;
+    this->limiter.lowLatency = config.lowLatency;
+    this->limiter.fpsCap = config.fpsCap;
+
     initSwapchain();
   }
 
@@ -34,8 +75,18 @@ namespace ren {
     REN_PROFILE_FUNCTION();
     waitForIdle();
 
+    this->retiredSwapchains.clear();
     this->swapchain.reset();
+    g_frameData = nullptr;
+    this->frames.clear();
     this->renderPass.reset();
+    this->uploads.reset();
+    this->transient.reset();
+    this->bindless.reset();
+    this->descriptorCache.reset();
+    this->gpuProfiler.reset();
+    // The device is idle, so this destroys everything that was deferred.
+    this->deletions.reset();
     this->vulkan.reset();
   }
 
@@ -48,21 +99,53 @@ namespace ren {
     REN_PROFILE_FUNCTION();
 
 
-    ren::FrameData *frame = nullptr;
+    auto *frame = this->frames[vulkan->frame_number % this->frames.size()].get();
+    g_frameData = frame;
+    // Everything up to having an image to render into is time spent waiting
+    // on the GPU or the display, which the frame limiter tries to sleep off.
+    u64 stallStart = profileNow();
+    {
+      REN_PROFILE_SCOPE("Wait for frame");
+      vulkan->graphics_timeline->wait(frame->submitValue);
+
+      // This frame's last submission is done, so its timestamps are ready.
+      frame->queries->collect();
+
+      vkResetCommandBuffer(frame->commandBuffer, 0);
+      frame->resetSecondaries();
+    }
+    // The GPU is done reading what this frame wrote last time around.
+    transient->beginFrame(frame->frameIndex);
+    deletions->collect();
+
+    // The frame's latency runs from when it started on the CPU to when the GPU finished it.
+    auto &gpuProfiler = GpuProfiler::get();
+    if (frame->startTime != 0 && gpuProfiler.getLastFrameEnd() > frame->startTime) {
+      limiter.addLatency(gpuProfiler.getLastFrameEnd() - frame->startTime);
+    }
+    frame->startTime = limiter.getFrameStart();
+
+    // Last frame may have found out the swapchain no longer fits the window
+    // (or the present mode changed).
+    bool recreated = this->swapchain->isOutOfDate();
+    if (recreated) this->initSwapchain();
 
     int resizeRetries = 0;
-    do {
-      frame = this->swapchain->acquireNextFrame();
-      if (frame == nullptr) {
-        // The swapchain is out of date, so we need to recreate it.
-        this->initSwapchain();
-        resizeRetries++;
-      }
-    } while (frame == nullptr);
+    while (!this->swapchain->acquireNextImage(*frame)) {
+      // The swapchain is out of date, so we need to recreate it.
+      this->initSwapchain();
+      resizeRetries++;
+    }
+    // Recreating the swapchain isn't the GPU's fault.
+    if (!recreated && resizeRetries == 0) limiter.addStall(profileNow() - stallStart);
     REN_PROFILE_COUNTER("Acquire Frame Attempts", resizeRetries);
 
 
     vulkan->frame_number += 1;
+    uploads->collect();
+    stats.drawCalls = 0;
+    computeRecording = false;
+    computeWaitStage = 0;
 
     // Initialize the frame's command buffer.
 
@@ -77,11 +160,15 @@ namespace ren {
       throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    // Query resets have to happen outside of the render pass.
+    frame->queries->reset(cmd);
+    frameZone = frame->queries->beginZone(cmd, "GPU Frame");
+
     // ---- Begin the Render Pass ---- //
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass->getHandle();
-    renderPassInfo.framebuffer = frame->deviceFramebuffer;
+    renderPassInfo.framebuffer = frame->image->framebuffer;
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = swapchain->deviceExtent;
 
@@ -94,10 +181,35 @@ namespace ren {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Everything in the pass is recorded into secondaries (see beginCommands).
+    vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  }
+
+
+  VkCommandBuffer Renderer::beginCommands(u32 order) {
+    auto &frame = ren::getFrameData();
+    u32 thread = JobSystem::getThreadIndex();
+    if (thread >= frame.threadCommands.size()) {
+      throw std::runtime_error("beginCommands() called from a thread outside the job system");
+    }
+
+    VkCommandBuffer cmd = frame.allocateSecondary(thread);
+    frame.threadCommands[thread].recorded.push_back({order, cmd});
 
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderPass->getHandle();
+    inheritance.subpass = 0;
+    inheritance.framebuffer = frame.image->framebuffer;
 
-    // oh.. do this stuff too.
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+    // Dynamic state isn't inherited from the primary.
     VkViewport viewport = {0.0f,
                            0.0f,  // x, y
                            (float)swapchain->deviceExtent.width,
@@ -108,6 +220,51 @@ namespace ren {
 
     VkRect2D scissor = {{0, 0}, swapchain->deviceExtent};
     vkCmdSetScissor(cmd, 0, 1, &scissor);
+    return cmd;
+  }
+
+
+  void Renderer::endCommands(VkCommandBuffer cmd) { VK_CHECK(vkEndCommandBuffer(cmd)); }
+
+
+  VkCommandBuffer Renderer::beginCompute(void) {
+    if (!JobSystem::isMainThread()) {
+      throw std::runtime_error("beginCompute() called off the main thread");
+    }
+    if (computeRecording || computeWaitStage != 0) {
+      throw std::runtime_error("beginCompute() called twice in one frame");
+    }
+    auto &frame = ren::getFrameData();
+    auto cmd = frame.computeCommandBuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+    // Make the last frame's compute writes visible to this frame's compute.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                         nullptr);
+
+    computeRecording = true;
+    return cmd;
+  }
+
+
+  void Renderer::submitCompute(VkPipelineStageFlags waitStage) {
+    REN_PROFILE_FUNCTION();
+    if (!computeRecording) throw std::runtime_error("submitCompute() without beginCompute()");
+    auto &frame = ren::getFrameData();
+    VK_CHECK(vkEndCommandBuffer(frame.computeCommandBuffer));
+
+    computeValue = QueueSubmit().add(frame.computeCommandBuffer).submit(*vulkan->compute_timeline);
+    computeRecording = false;
+    computeWaitStage = waitStage;
   }
 
 
@@ -125,9 +282,33 @@ namespace ren {
 
     auto &frame = ren::getFrameData();
 
+    REN_PROFILE_COUNTER("Draw Calls", stats.drawCalls.load());
+    // Should be zero once everything has been drawn once.
+    REN_PROFILE_COUNTER("Descriptor Sets Allocated", descriptorCache->takeMisses());
 
+    {
+      REN_PROFILE_SCOPE("Execute Secondaries");
+      // Gather every thread's secondaries and run them in order. Which thread
+      // recorded a buffer doesn't matter, so the primary is the same every run.
+      std::vector<std::pair<u32, VkCommandBuffer>> recorded;
+      for (auto &thread : frame.threadCommands) {
+        recorded.insert(recorded.end(), thread.recorded.begin(), thread.recorded.end());
+      }
+      std::stable_sort(recorded.begin(), recorded.end(),
+                       [](const auto &a, const auto &b) { return a.first < b.first; });
+
+      std::vector<VkCommandBuffer> buffers;
+      buffers.reserve(recorded.size());
+      for (auto &[order, buffer] : recorded) buffers.push_back(buffer);
+      if (!buffers.empty()) {
+        vkCmdExecuteCommands(frame.commandBuffer, static_cast<u32>(buffers.size()),
+                             buffers.data());
+      }
+      REN_PROFILE_COUNTER("Secondary Command Buffers", buffers.size());
+    }
 
     vkCmdEndRenderPass(frame.commandBuffer);
+    frame.queries->endZone(frame.commandBuffer, frameZone);
 
     // And we've finished recording the command buffer:
     if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS) {
@@ -135,65 +316,60 @@ namespace ren {
     }
 
 
-
-
-    // TODO: abstract all this.
-    VkSemaphore signalSemaphores[] = {frame.renderFinishedSemaphore};
+    // Anything uploaded while recording this frame has to land before it runs.
+    uploads->flush();
+    if (computeRecording) submitCompute(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
 
     {
       REN_PROFILE_SCOPE("Submit Graphics Queue");
-      VkSubmitInfo submitInfo{};
-      submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-      VkSemaphore waitSemaphores[] = {frame.imageAvailableSemaphore};
-      VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-      submitInfo.waitSemaphoreCount = 1;
-      submitInfo.pWaitSemaphores = waitSemaphores;
-      submitInfo.pWaitDstStageMask = waitStages;
-
-      submitInfo.commandBufferCount = 1;
-      submitInfo.pCommandBuffers = &frame.commandBuffer;
-
-      submitInfo.signalSemaphoreCount = 1;
-      submitInfo.pSignalSemaphores = signalSemaphores;
-
-      if (vkQueueSubmit(vulkan->graphics_queue, 1, &submitInfo, frame.inFlightFence) !=
-          VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+      QueueSubmit submit;
+      submit.add(frame.commandBuffer);
+      // Headless frames don't acquire or present, so there's nothing to synchronize with.
+      if (!isHeadless()) {
+        submit.wait(frame.imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        submit.signal(frame.image->renderFinishedSemaphore);
+      }
+      if (computeWaitStage != 0) {
+        submit.wait(*vulkan->compute_timeline, computeValue, computeWaitStage);
       }
+      frame.submitValue = submit.submit(*vulkan->graphics_timeline);
+      frame.image->submitValue = frame.submitValue;
     }
+    // Whatever was released while recording the frame goes once it's done.
+    deletions->submitted(frame.submitValue);
 
 
     {
       REN_PROFILE_SCOPE("Presentation");
+      swapchain->present(frame);
+    }
 
-      // Presentation
-      VkPresentInfoKHR presentInfo{};
-      presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-      presentInfo.waitSemaphoreCount = 1;
-      presentInfo.pWaitSemaphores = signalSemaphores;
+    // Presents are processed in queue order, so now that the new swapchain
+    // has one queued, the old swapchains' presents are ahead of it. Tying
+    // them to the next frame's submission means they go once that's done.
+    for (auto &old : retiredSwapchains) DeletionQueue::defer([old] {});
+    retiredSwapchains.clear();
+  }
 
-      VkSwapchainKHR swapChains[] = {swapchain->swapchain};
-      presentInfo.swapchainCount = 1;
-      presentInfo.pSwapchains = swapChains;
-      uint32_t index = frame.frameIndex;  // we need a u32
-      presentInfo.pImageIndices = &index;
 
-      presentInfo.pResults = nullptr;  // Optional
-      vkQueuePresentKHR(vulkan->graphics_queue, &presentInfo);
-    }
+  void Renderer::setPresentMode(VkPresentModeKHR mode) {
+    if (mode == presentMode) return;
+    presentMode = mode;
+    swapchain->markOutOfDate();
   }
 
 
   void Renderer::initSwapchain(void) {
     REN_PROFILE_FUNCTION();
 
-    // wait for the GPU to be idle.
-    this->vulkan->waitForIdle();
-    this->swapchain.reset();
-
-    this->swapchain = makeBox<ren::Swapchain>(this->window);
+    // Frames still in flight may be rendering into the old swapchain's images,
+    // and presents queued for it may still be waiting on their
+    // renderFinishedSemaphores. Presenting doesn't signal anything we can
+    // wait on, so instead of waiting here the old one is kept until the new
+    // one has presented an image (see endFrame).
+    auto old = std::move(this->swapchain);
+    this->swapchain = makeRef<ren::Swapchain>(this->window, headlessExtent, presentMode, old.get());
+    if (old != nullptr) retiredSwapchains.push_back(std::move(old));
   }
 
 }  // namespace ren
\ No newline at end of file
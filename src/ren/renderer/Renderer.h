@@ -7,10 +7,20 @@
 #include <ren/renderer/Image.h>
 #include <ren/renderer/Texture.h>
 #include <ren/renderer/Vulkan.h>
+#include <ren/renderer/GpuProfiler.h>
+#include <ren/renderer/UploadQueue.h>
+#include <ren/renderer/FrameLimiter.h>
 #include <SDL2/SDL.h>
 
 namespace ren {
 
+  // Counts of what was recorded into a frame. Reset by beginFrame().
+  struct FrameStats {
+    // Recorded from many threads.
+    std::atomic<u32> drawCalls = 0;
+  };
+
+
   // This class attempts to provide a generic interface for rendering triangles in a 3D Scene.
   // We render to a renderTarget, which is a ren::Texture, and then have a separate pass which
   // blits that renderTarget to the swapchain image.
@@ -18,11 +28,37 @@ namespace ren {
    public:
     // This is the public interface for the renderer
 
-    Renderer(SDL_Window *window);
+    // Pass a null window to render headless, into offscreen images of `headlessExtent`.
+    Renderer(SDL_Window *window, VkExtent2D headlessExtent = {0, 0});
     ~Renderer(void);
 
     // Called at the start of a frame. Sync's with the swapchain and acquires the next frame data.
     void beginFrame(void);
+    // Begin a secondary command buffer that draws into the scene pass. This can
+    // be called from any job system thread, concurrently. At the end of the
+    // frame the secondaries are executed in ascending `order`, so give each
+    // one a distinct order and the frame comes out the same no matter which
+    // thread recorded what. Viewport and scissor are already set.
+    VkCommandBuffer beginCommands(u32 order);
+    void endCommands(VkCommandBuffer cmd);
+
+    // Orders for beginCommands. The scene adds its own offsets to ORDER_SCENE.
+    static constexpr u32 ORDER_SCENE = 0;
+    static constexpr u32 ORDER_UI = 0x80000000;
+
+    // Begin this frame's async compute command buffer. Main thread only, at
+    // most once a frame, between beginFrame() and endFrame(). It runs on the
+    // compute queue, so it can overlap the previous frame's rasterization.
+    // Work in it sees what earlier frames' compute wrote, but only sees
+    // uploads that have completed (wait on their UploadQueue ticket).
+    //
+    // Anything compute writes that graphics reads should have a copy per frame
+    // in flight: waiting for the frame to finish is then all that keeps the two apart.
+    VkCommandBuffer beginCompute(void);
+    // Submit the compute command buffer. This frame's graphics work waits for
+    // it at `waitStage`. endFrame() submits it if this wasn't called.
+    void submitCompute(VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+
     // Called when the scene is done being rendered, and it should be blitted to the swapchain.
     void finalizeScene(void);
     // Called at the end of the frame to submit everything and present the frame.
@@ -30,20 +66,70 @@ namespace ren {
 
     void waitForIdle(void);
 
+    bool isHeadless(void) const { return window == nullptr; }
+
 
 
     static Renderer &get(void);
 
     ren::RenderPass &getRenderPass(void) { return *renderPass; }
+    VkExtent2D getExtent(void) const { return swapchain->deviceExtent; }
+    // How many frames can be in flight at once. Fixed at startup, and independent
+    // of how many images the swapchain has.
+    u32 getFrameCount(void) const { return static_cast<u32>(frames.size()); }
+
+    // The mode asked for. The swapchain may have fallen back to another one
+    // (see getActivePresentMode). Setting it recreates the swapchain before the
+    // next frame.
+    VkPresentModeKHR getPresentMode(void) const { return presentMode; }
+    VkPresentModeKHR getActivePresentMode(void) const { return swapchain->presentMode; }
+    void setPresentMode(VkPresentModeKHR mode);
+
+    // The application calls wait() on this before sampling each frame's input.
+    // The Renderer feeds it how long frames stall, and how long they take.
+    FrameLimiter &getFrameLimiter(void) { return limiter; }
+
+    // Scratch memory for uniforms, storage, vertices and indices that are only
+    // needed by the frame being recorded. beginFrame() rewinds it, so writing
+    // into it is a pointer bump and a memcpy (see DynamicBuffer).
+    DynamicBuffer<u8> &getTransientBuffer(void) { return *transient; }
+    static constexpr size_t TRANSIENT_BYTES = 1024 * 1024;
+
+    // The stats of the frame being recorded. Whoever records a draw should bump drawCalls.
+    FrameStats &getStats(void) { return stats; }
 
 
    private:
+    // Replace the swapchain (or create the first one) without waiting on the GPU.
     void initSwapchain();
 
    private:
     SDL_Window *window;
+    VkExtent2D headlessExtent;
     ref<VulkanInstance> vulkan = nullptr;
+    box<GpuProfiler> gpuProfiler = nullptr;
+    box<UploadQueue> uploads = nullptr;
+    box<DeletionQueue> deletions = nullptr;
+    box<DescriptorCache> descriptorCache = nullptr;
+    box<BindlessTextures> bindless = nullptr;
+    box<DynamicBuffer<u8>> transient = nullptr;
+    // The zone covering the whole of the current frame's command buffer.
+    u32 frameZone = UINT32_MAX;
+    // Where this frame's compute work is at.
+    bool computeRecording = false;
+    // The stage graphics waits for compute at, or 0 if nothing was submitted.
+    VkPipelineStageFlags computeWaitStage = 0;
+    // The compute timeline value graphics waits for.
+    u64 computeValue = 0;
     ref<RenderPass> renderPass;
+    // One per frame in flight, used round robin. They outlive the swapchain.
+    std::vector<box<FrameData>> frames;
     ref<Swapchain> swapchain = nullptr;
+    // Replaced swapchains whose presents may still be queued. Released once
+    // the current one has presented (see endFrame).
+    std::vector<ref<Swapchain>> retiredSwapchains;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    FrameLimiter limiter;
+    FrameStats stats;
   };
 }  // namespace ren
\ No newline at end of file
@@ -4,12 +4,12 @@
 #include <ren/renderer/Vulkan.h>
 #include "vulkan/vulkan_core.h"
 #include <fstream>
+#include <algorithm>
 #include <spirv_reflect/spirv_reflect.h>
-#include <spirv_reflect/common.h>
-#include <spirv_reflect/output_stream.h>
 
 ren::Shader::Shader(const std::string& file_name, VkShaderStageFlagBits stage)
-    : stage(stage) {
+    : filename(file_name)
+    , stage(stage) {
   auto code = loadShaderCode(file_name);
   initShader(code);
 }
@@ -42,140 +42,84 @@ std::vector<u8> ren::Shader::loadShaderCode(const std::string& filename) {
   return code;
 }
 
-#if 0
-static void print_push_constant_block(std::ostream& os, const SpvReflectBlockVariable& block,
-                                      int depth = 0) {
-  std::string indent(depth * 2, ' ');
-
-  os << indent << "name:             " << block.name << "\n";
-  os << indent << "spirv_id:         " << block.spirv_id << "\n";
-  os << indent << "size:             " << block.size << "\n";
-  os << indent << "offset:           " << block.offset << "\n";
-  os << indent << "decoration_flags: " << block.decoration_flags << "\n";
-
-
-  if (block.member_count != 0) {
-    os << indent << "members:          " << block.member_count << "\n";
-    for (int i = 0; i < block.member_count; i++) {
-      print_push_constant_block(os, block.members[i], depth + 1);
-    }
-  }
-  std::cout << "\n";
-};
-#endif
-
 void ren::Shader::initShader(const std::vector<u8>& code) {
-#if 0
-  // Generate reflection data for a shader
-  SpvReflectShaderModule module;
-  SpvReflectResult result = spvReflectCreateShaderModule(code.size(), code.data(), &module);
-  assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-  // Enumerate and extract shader's input variables
-  uint32_t var_count = 0;
-  result = spvReflectEnumerateInputVariables(&module, &var_count, NULL);
-
-  std::vector<SpvReflectInterfaceVariable*> vars(var_count);
-  result = spvReflectEnumerateInputVariables(&module, &var_count, vars.data());
+  reflect(code);
 
-  PrintModuleInfo(std::cout, module);
+  auto& vulkan = ren::getVulkan();
 
-  const char* t = "  ";
-  const char* tt = "    ";
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-  std::cout << "Interface Variables:\n";
-  for (size_t index = 0; index < vars.size(); ++index) {
-    auto v = vars[index];
-    std::cout << t << index << ":"
-              << "\n";
-    PrintInterfaceVariable(std::cout, module.source_language, *v, tt);
-    std::cout << "\n";
+  if (vkCreateShaderModule(vulkan.device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module!");
   }
+}
 
 
-  u32 pcs_count = 0;
-  spvReflectEnumeratePushConstantBlocks(&module, &pcs_count, NULL);
-  std::vector<SpvReflectBlockVariable*> pcs(pcs_count);
-  spvReflectEnumeratePushConstantBlocks(&module, &pcs_count, pcs.data());
-
-
-
-  std::cout << "Push Constants:\n";
-  for (size_t index = 0; index < pcs.size(); ++index) {
-    auto& obj = *pcs[index];
-    auto& os = std::cout;
-
-    os << t << index << ":\n";
-
-    print_push_constant_block(os, obj, 1);
-
-    // os << tt << "name:     : " << obj.name << "\n";
-    // os << tt << "offset    : " << obj.offset << "\n";
-    // os << tt << "size      : " << obj.size  << "\n";
-    // os << tt << "qualifier : ";
-    // if (obj.decoration_flags & SPV_REFLECT_DECORATION_FLAT) {
-    //   os << "flat";
-    // } else if (obj.decoration_flags & SPV_REFLECT_DECORATION_NOPERSPECTIVE) {
-    //   os << "noperspective";
-    // } else if (obj.decoration_flags & SPV_REFLECT_DECORATION_PATCH) {
-    //   os << "patch";
-    // } else if (obj.decoration_flags & SPV_REFLECT_DECORATION_PER_VERTEX) {
-    //   os << "pervertex";
-    // } else if (obj.decoration_flags & SPV_REFLECT_DECORATION_PER_TASK) {
-    //   os << "pertask";
-    // } else {
-    //   os << "unknown";
-    // }
-    // os << "\n";
-
-
-    std::cout << "\n";
+void ren::Shader::reflect(const std::vector<u8>& code) {
+  SpvReflectShaderModule module;
+  if (spvReflectCreateShaderModule(code.size(), code.data(), &module) !=
+      SPV_REFLECT_RESULT_SUCCESS) {
+    throw std::runtime_error(fmt::format("Failed to reflect shader: {}", filename));
+  }
+  // The two enums share their values.
+  if (static_cast<VkShaderStageFlagBits>(module.shader_stage) != stage) {
+    spvReflectDestroyShaderModule(&module);
+    throw std::runtime_error(fmt::format("{} is not a {} shader", filename, (u32)stage));
   }
 
-
-  // Grab Descriptor sets
-  uint32_t count = 0;
-  result = spvReflectEnumerateDescriptorSets(&module, &count, NULL);
-  assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
+  // ---- Descriptor Sets ---- //
+  u32 count = 0;
+  spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
   std::vector<SpvReflectDescriptorSet*> sets(count);
-  result = spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
-  assert(result == SPV_REFLECT_RESULT_SUCCESS);
-
-
-  // Log the descriptor set contents to stdout
-
-
-  std::cout << "Descriptor sets:\n";
-  for (size_t index = 0; index < sets.size(); ++index) {
-    auto p_set = sets[index];
+  spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
+  for (auto set : sets) {
+    auto& bindings = reflection.sets[set->set];
+    for (u32 i = 0; i < set->binding_count; i++) {
+      auto& binding = *set->bindings[i];
+      VkDescriptorSetLayoutBinding layoutBinding{};
+      layoutBinding.binding = binding.binding;
+      layoutBinding.descriptorType = static_cast<VkDescriptorType>(binding.descriptor_type);
+      // The product of the array's dimensions, which is 0 for a runtime array.
+      layoutBinding.descriptorCount = binding.count;
+      layoutBinding.stageFlags = stage;
+      bindings.push_back(layoutBinding);
+    }
+  }
 
-    // descriptor sets can also be retrieved directly from the module, by set
-    // index
-    auto p_set2 = spvReflectGetDescriptorSet(&module, p_set->set, &result);
-    assert(result == SPV_REFLECT_RESULT_SUCCESS);
-    assert(p_set == p_set2);
-    (void)p_set2;
+  // ---- Push Constants ---- //
+  // GLSL only allows one block per stage.
+  count = 0;
+  spvReflectEnumeratePushConstantBlocks(&module, &count, nullptr);
+  std::vector<SpvReflectBlockVariable*> blocks(count);
+  spvReflectEnumeratePushConstantBlocks(&module, &count, blocks.data());
+  if (!blocks.empty()) {
+    // Measured from the members, since the block's size is padded.
+    auto& block = *blocks[0];
+    u32 begin = block.offset, end = block.offset + block.size;
+    if (block.member_count > 0) {
+      begin = UINT32_MAX;
+      end = 0;
+      for (u32 i = 0; i < block.member_count; i++) {
+        begin = std::min(begin, block.members[i].offset);
+        end = std::max(end, block.members[i].offset + block.members[i].size);
+      }
+    }
+    reflection.pushConstantOffset = begin;
+    reflection.pushConstantSize = end - begin;
+  }
 
-    std::cout << t << index << ":"
-              << "\n";
-    PrintDescriptorSet(std::cout, *p_set, tt);
-    std::cout << "\n\n";
+  // ---- Inputs ---- //
+  count = 0;
+  spvReflectEnumerateInputVariables(&module, &count, nullptr);
+  std::vector<SpvReflectInterfaceVariable*> inputs(count);
+  spvReflectEnumerateInputVariables(&module, &count, inputs.data());
+  for (auto input : inputs) {
+    if (input->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) continue;
+    reflection.inputs.push_back({input->location, static_cast<VkFormat>(input->format)});
   }
 
-  std::cout << "\n\n";
   spvReflectDestroyShaderModule(&module);
-
-  //////////////
-#endif
-  auto& vulkan = ren::getVulkan();
-
-  VkShaderModuleCreateInfo createInfo{};
-  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  createInfo.codeSize = code.size();
-  createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-  if (vkCreateShaderModule(vulkan.device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create shader module!");
-  }
 }
@@ -3,12 +3,34 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <ren/types.h>
 
 namespace ren {
   class VulkanInstance;
 
 
+  // What a shader declares, reflected from its SPIR-V when it's loaded.
+  // Pipelines build their layouts out of this instead of writing them by hand.
+  struct ShaderReflection {
+    struct Input {
+      u32 location;
+      VkFormat format;
+    };
+
+    // The bindings in each set, with stageFlags set to the shader's stage. A
+    // runtime sized array (`sampler2D textures[]`) has a descriptorCount of 0:
+    // only whoever owns the descriptor set knows how big it is.
+    std::map<u32, std::vector<VkDescriptorSetLayoutBinding>> sets;
+    // The bytes of the push constant block the shader reads. Zero sized if
+    // there is no block.
+    u32 pushConstantOffset = 0;
+    u32 pushConstantSize = 0;
+    // The stage's inputs (vertex attributes, for a vertex shader), without built-ins.
+    std::vector<Input> inputs;
+  };
+
+
   // This class is the base class for all Vulkan shaders in the engine.
   // It's mainly responsible for manging the lifetime of teh VkShaderModule
   // and providing the shader stage so the pipeline can use it.
@@ -22,16 +44,20 @@ namespace ren {
     const std::string &getFilename() const { return filename; }
     VkShaderModule getHandle() const { return shaderModule; }
     VkShaderStageFlagBits getStage() const { return stage; }
+    const ShaderReflection &getReflection() const { return reflection; }
 
    private:
     std::vector<u8> loadShaderCode(const std::string &file_name);
 
     void initShader(const std::vector<u8> &code);
+    // Fill in `reflection`. Throws if the code isn't a `stage` shader.
+    void reflect(const std::vector<u8> &code);
 
 
     std::string filename;
     VkShaderModule shaderModule = VK_NULL_HANDLE;
     VkShaderStageFlagBits stage;
+    ShaderReflection reflection;
   };
 
 
@@ -7,22 +7,28 @@
 #include <ren/core/Application.h>
 
 
-static ren::FrameData *g_frameData = nullptr;
-
 namespace ren {
-  FrameData &getFrameData(void) {
-    if (!g_frameData) {
-      throw std::runtime_error("Frame data not initialized. Call Swapchain::init() first.");
+
+  const char *Swapchain::getPresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+      case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+      case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+      case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+      case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+      default: return "unknown";
     }
-    return *g_frameData;
   }
 
 
-  Swapchain::Swapchain(SDL_Window *window)
+  Swapchain::Swapchain(SDL_Window *window, VkExtent2D headlessExtent,
+                       VkPresentModeKHR presentMode, Swapchain *old)
       : window(window) {
-    this->frameIndex = 0;
     auto &vulkan = ren::getVulkan();
-    vulkan.frame_number = 0;
+
+    if (vulkan.isHeadless()) {
+      initHeadless(headlessExtent, old);
+      return;
+    }
 
     int width, height;
     SDL_Vulkan_GetDrawableSize(window, &width, &height);
@@ -39,9 +45,18 @@ namespace ren {
     // ---- Allocate the Swapchain for device target rendering ---- //
     vkb::SwapchainBuilder swapchain_builder(vulkan.physical_device, vulkan.device, vulkan.surface);
 
+    // vkb takes the first of these the surface supports, and FIFO if none are.
+    swapchain_builder.set_desired_present_mode(presentMode);
+    if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+      swapchain_builder.add_fallback_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+    } else if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+      swapchain_builder.add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
+    }
+
+    if (old != nullptr) swapchain_builder.set_old_swapchain(old->swapchain);
+
     vkb::Swapchain vkb_swapchain =
         swapchain_builder.use_default_format_selection()
-            .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
             .set_image_usage_flags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
                                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
             .set_desired_format(
@@ -55,70 +70,200 @@ namespace ren {
     auto imageViews = vkb_swapchain.get_image_views().value();
 
     this->swapchain = vkb_swapchain.swapchain;
+    this->presentMode = vkb_swapchain.present_mode;
     this->imageFormat = vkb_swapchain.image_format;
     this->depthFormat = vulkan.findDepthFormat();
 
-    fmt::print("Vulkan swapchain created with {} images, extent: {}x{}\n", images.size(),
-               deviceExtent.width, deviceExtent.height);
+    fmt::print("Vulkan swapchain created with {} images, extent: {}x{}, present mode: {}\n",
+               images.size(), deviceExtent.width, deviceExtent.height,
+               getPresentModeName(this->presentMode));
+
+    initDepth(old);
 
     for (u64 i = 0; i < images.size(); i++) {
-      frames.push_back(makeBox<ren::FrameData>(i, *this, images[i], imageViews[i]));
+      // ---- Wrap the swapchain image in a ren::Image ---- //
+      VkImageCreateInfo imageCreateInfo = {};  // Just so the ren::Image class can have it.
+      imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+      imageCreateInfo.format = imageFormat;
+      imageCreateInfo.extent.width = deviceExtent.width;
+      imageCreateInfo.extent.height = deviceExtent.height;
+      imageCreateInfo.extent.depth = 1;
+
+      auto deviceImage = ren::Image::create(fmt::format("device #{}", i), images[i],
+                                            imageViews[i],
+                                            VK_NULL_HANDLE,  // Null allocation is a little strange.
+                                            imageCreateInfo);
+      this->images.push_back(makeBox<SwapchainImage>(i, *this, deviceImage));
+    }
+  }
+
+
+  void Swapchain::initHeadless(VkExtent2D extent, Swapchain *old) {
+    auto &vulkan = ren::getVulkan();
+    this->deviceExtent = extent;
+    this->renderExtent.width = target_render_width;
+    this->renderExtent.height = target_render_height;
+    this->imageFormat = vulkan.swapchainFormat;
+    this->depthFormat = vulkan.findDepthFormat();
+
+    fmt::print("Creating headless ren::Swapchain: {}x{}\n", extent.width, extent.height);
+    initDepth(old);
+
+    // One image per frame in flight is enough, since nothing holds onto them
+    // for presentation.
+    u32 count = Renderer::get().getFrameCount();
+    for (u32 i = 0; i < count; i++) {
+      auto deviceImage = ren::ImageBuilder(fmt::format("device #{}", i))
+                             .setWidth(extent.width)
+                             .setHeight(extent.height)
+                             .setFormat(imageFormat)
+                             .setUsage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
+                             .build();
+      this->images.push_back(makeBox<SwapchainImage>(i, *this, deviceImage));
+    }
+  }
+
+
+  void Swapchain::initDepth(Swapchain *old) {
+    if (old != nullptr && old->depthImage != nullptr &&
+        old->depthImage->getWidth() >= deviceExtent.width &&
+        old->depthImage->getHeight() >= deviceExtent.height) {
+      this->depthImage = old->depthImage;
+      return;
+    }
+
+    // Grow to cover both, so shrinking back down later doesn't reallocate either.
+    VkExtent2D extent = deviceExtent;
+    if (old != nullptr && old->depthImage != nullptr) {
+      extent.width = std::max(extent.width, old->depthImage->getWidth());
+      extent.height = std::max(extent.height, old->depthImage->getHeight());
     }
+    this->depthImage = ren::ImageBuilder("depth")
+                           .setWidth(extent.width)
+                           .setHeight(extent.height)
+                           .setFormat(depthFormat)
+                           .setUsage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                           .setViewAspectMask(VK_IMAGE_ASPECT_DEPTH_BIT)
+                           .build();
   }
 
 
   Swapchain::~Swapchain() {
     auto &vulkan = ren::getVulkan();
-    // wait for idle.
-    vkDeviceWaitIdle(vulkan.device);
-    fmt::print("Destroying Swapchain with {} frames\n", frames.size());
-    // Clear the swapchain data.
-    // TODO: make sure nobody is using any of these!
-    frames.clear();
-    vkDestroySwapchainKHR(vulkan.device, swapchain, nullptr);
+    // The Renderer only lets go of a swapchain once the GPU is done with it.
+    fmt::print("Destroying Swapchain with {} images\n", images.size());
+    images.clear();
+    if (swapchain != VK_NULL_HANDLE) vkDestroySwapchainKHR(vulkan.device, swapchain, nullptr);
   }
 
 
-  ren::FrameData *Swapchain::acquireNextFrame(void) {
+  bool Swapchain::acquireNextImage(FrameData &frame) {
     REN_PROFILE_FUNCTION();
     auto &vulkan = ren::getVulkan();
-    if (frames.empty()) {
-      fmt::print("No frames available in swapchain\n");
-      return nullptr;
+    if (images.empty()) {
+      fmt::print("No images available in swapchain\n");
+      return false;
     }
-    frameIndex = vulkan.frame_number % frames.size();
 
-    // Get the current frame data.
-    auto frameData = frames[frameIndex].get();
-    g_frameData = frameData;
+    if (isHeadless()) {
+      headlessImage = (headlessImage + 1) % images.size();
+      frame.image = images[headlessImage].get();
+      // Offscreen images are ours as soon as the timeline says the GPU is done with them.
+      REN_PROFILE_SCOPE("Wait for image");
+      vulkan.graphics_timeline->wait(frame.image->submitValue);
+      return true;
+    }
 
-    assert(frameData->frameIndex == frameIndex);
-    {
-      REN_PROFILE_SCOPE("Wait for fences");
-      vkWaitForFences(vulkan.device, 1, &frameData->inFlightFence, VK_TRUE, UINT64_MAX);
-      vkResetFences(vulkan.device, 1, &frameData->inFlightFence);
+    u32 index = 0;
+    auto result = vkAcquireNextImageKHR(vulkan.device, this->swapchain, UINT64_MAX,
+                                        frame.imageAvailableSemaphore, VK_NULL_HANDLE, &index);
 
-      vkResetCommandBuffer(frameData->commandBuffer, 0);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      outOfDate = true;
+      return false;
+    } else if (result == VK_SUBOPTIMAL_KHR) {
+      // The image was acquired (and the semaphore will signal), so it has to
+      // be used. Render this frame, and recreate before the next one.
+      outOfDate = true;
+    } else if (result != VK_SUCCESS) {
+      fmt::print("Failed to acquire swapchain image {}\n", (int)result);
+      // TODO: what does this mean? I usually see -4 here.
+      outOfDate = true;
+      return false;
     }
 
+    frame.image = images[index].get();
+    return true;
+  }
 
 
-    // fmt::println("Acquiring next image for frame index: {}", frameData->frameIndex);
+  void Swapchain::present(FrameData &frame) {
+    REN_PROFILE_FUNCTION();
+    if (isHeadless()) return;
 
-    auto result = vkAcquireNextImageKHR(vulkan.device, this->swapchain, UINT64_MAX,
-                                        frameData->imageAvailableSemaphore, VK_NULL_HANDLE,
-                                        &frameData->frameIndex);
+    VkPresentInfoKHR presentInfo{};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-        vulkan.framebuffer_resized) {
-      return nullptr;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-      fmt::print("Failed to acquire swapchain image {}\n", (int)result);
-      // TODO: what does this mean? I usually see -4 here.
-      return nullptr;
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &frame.image->renderFinishedSemaphore;
+
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &this->swapchain;
+    presentInfo.pImageIndices = &frame.image->index;
+
+    presentInfo.pResults = nullptr;  // Optional
+    auto result = vkQueuePresentKHR(ren::getVulkan().graphics_queue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) outOfDate = true;
+  }
+
+
+  // ---- SwapchainImage ---- //
+
+  SwapchainImage::SwapchainImage(u32 index, Swapchain &sc, ren::ImageRef deviceImage) {
+    this->index = index;
+    auto &vulkan = ren::getVulkan();
+    this->deviceImage = deviceImage;
+
+    // allocate the framebuffer
+    VkFramebufferCreateInfo framebufferCreate{};
+
+    // The depth buffer may be bigger than the framebuffer, which is fine.
+    std::array<VkImageView, 2> attachments = {this->deviceImage->getImageView(),
+                                              sc.depthImage->getImageView()};
+
+    framebufferCreate.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferCreate.renderPass = ren::Renderer::get().getRenderPass().getHandle();
+    framebufferCreate.attachmentCount = attachments.size();
+    framebufferCreate.pAttachments = attachments.data();
+    framebufferCreate.width = sc.deviceExtent.width;
+    framebufferCreate.height = sc.deviceExtent.height;
+    framebufferCreate.layers = 1;
+    if (vkCreateFramebuffer(vulkan.device, &framebufferCreate, nullptr, &this->framebuffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("Failed to create device framebuffer");
     }
 
-    return frameData;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VK_CHECK(
+        vkCreateSemaphore(vulkan.device, &semaphoreInfo, nullptr, &this->renderFinishedSemaphore));
+  }
+
+
+  SwapchainImage::~SwapchainImage() {
+    auto &vulkan = ren::getVulkan();
+
+    // This needs to be done because the ImageView is not managed by the Swapchain
+    if (this->deviceImage->isExternal()) {
+      vkDestroyImageView(vulkan.device, this->deviceImage->getImageView(), nullptr);
+    }
+    this->renderImage.reset();
+    this->deviceImage.reset();
+    vkDestroyFramebuffer(vulkan.device, this->renderFramebuffer, nullptr);
+    vkDestroyFramebuffer(vulkan.device, this->framebuffer, nullptr);
+    vkDestroySemaphore(vulkan.device, this->renderFinishedSemaphore, nullptr);
   }
 
 }  // namespace ren
\ No newline at end of file
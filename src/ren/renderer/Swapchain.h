@@ -8,41 +8,125 @@
 namespace ren {
 
   class Application;
-
-  // Get the current frame data from anywhere in the engine.
-  FrameData &getFrameData(void);
+  class Swapchain;
 
   constexpr u32 target_render_width = 320;
   constexpr u32 target_render_height = 180;
 
 
-  // This class implements a swapchain for rendering multiple frames at once.
-  // This engine defaults to triple buffering. We also have a lower resolution
-  // render target for game assets, and we blit that to the device resolution
-  // surface.
+  // One of the swapchain's images, and the framebuffer we render into it
+  // with. These live as long as the swapchain does, and a frame borrows one
+  // between acquiring and presenting it.
+  struct SwapchainImage {
+    // The index the swapchain knows this image by.
+    u32 index;
+
+    // We have a device image, which is the final image that is presented
+    // to the device in the end.
+    ren::ImageRef deviceImage = nullptr;
+
+    // The framebuffer we target when rendering the device image, with the
+    // swapchain's depth buffer.
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+    // These images are used for rendering the scene. They are at "render
+    // resolution", which is typically much lower than the device resolution.
+    // Only the old VulkanInstance path uses them, and nothing allocates them.
+    ren::ImageRef renderImage = nullptr;
+    VkFramebuffer renderFramebuffer = VK_NULL_HANDLE;
+
+    // Signals when the rendering is finished and the image is ready to be
+    // presented. It belongs to the image rather than the frame: the
+    // presentation engine may still be waiting on it after the frame that
+    // signalled it has been reused, but never after the image comes back.
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    // The graphics timeline value of the last frame that rendered into this image.
+    u64 submitValue = 0;
+
+    // `deviceImage` is either a swapchain image, or an offscreen image when headless.
+    SwapchainImage(u32 index, Swapchain &sc, ren::ImageRef deviceImage);
+    ~SwapchainImage();
+  };
+
+
+  // This class implements the swapchain's half of rendering: its images, the
+  // depth buffer, and acquiring and presenting them. The per-frame resources (command buffers,
+  // queries and so on) belong to the Renderer's frames in flight instead, so
+  // how many frames are in flight doesn't depend on how many images the
+  // surface gives us. We also have a lower resolution render target for game
+  // assets, and we blit that to the device resolution surface.
+  //
+  // Resizing doesn't wait for the GPU. The new swapchain is built from the old
+  // one (so the driver can hand resources over), and the Renderer keeps the
+  // old one alive until the new one has presented and the frame after that
+  // has finished, by when nothing can be using it anymore. There is only
+  // one depth buffer, shared by every image (the render pass orders frames'
+  // depth writes), and the new swapchain takes it over from the old one
+  // unless it has grown past it.
+  //
+  // When the Vulkan instance is headless there is no VkSwapchainKHR at all.
+  // Instead we render into a set of offscreen images, and nothing is presented.
   class Swapchain {
    public:
-    // We have one frame for each frame in flight.
-    // In a triple buffering setup, this is 3.
-    u32 frameIndex = 0;
-    std::vector<std::unique_ptr<ren::FrameData>> frames;
+    std::vector<box<SwapchainImage>> images;
 
     VkExtent2D renderExtent;
     VkExtent2D deviceExtent;
 
-    VkSwapchainKHR swapchain;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    // The mode we actually got, which may be a fallback for the one asked for.
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
     VkFormat imageFormat;
     VkFormat depthFormat;
+    // At least as big as deviceExtent, but maybe bigger.
+    ren::ImageRef depthImage = nullptr;
 
     SDL_Window *window;
 
 
-    Swapchain(SDL_Window *window);
+    // The extent is only used when headless. Otherwise we use the window's size.
+    //
+    // If the surface doesn't support `presentMode` we fall back to the closest
+    // thing it does: FIFO_RELAXED to FIFO, and MAILBOX and IMMEDIATE (which
+    // both don't wait for vblank) to each other, then FIFO, which always works.
+    //
+    // `old` is the swapchain this one replaces, if there is one. It is retired
+    // by this (it can still present, but not acquire), and has to be kept
+    // alive until the GPU is done with its images.
+    Swapchain(SDL_Window *window, VkExtent2D headlessExtent = {0, 0},
+              VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR, Swapchain *old = nullptr);
     ~Swapchain();
 
 
-    // Acquire a frame from the swapchain.
-    // If this returns NULL, the swapchain is out of date.
-    FrameData *acquireNextFrame(void);
+    // Acquire the next image, and point `frame.image` at it. The image can be
+    // rendered to once `frame.imageAvailableSemaphore` signals. Returns false
+    // if the swapchain is out of date, in which case nothing was acquired.
+    bool acquireNextImage(FrameData &frame);
+    // Present `frame.image` once its renderFinishedSemaphore signals. Does
+    // nothing when headless.
+    void present(FrameData &frame);
+
+    // True once acquiring or presenting has reported that the swapchain no
+    // longer matches the surface. It still works, but should be recreated.
+    bool isOutOfDate(void) const { return outOfDate; }
+    // Have the Renderer recreate the swapchain before the next frame.
+    void markOutOfDate(void) { outOfDate = true; }
+    bool isHeadless(void) const { return swapchain == VK_NULL_HANDLE; }
+
+    // The modes the application knows how to ask for, and their names on the
+    // command line and in the UI.
+    static constexpr std::array<VkPresentModeKHR, 4> PRESENT_MODES = {
+        VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_IMMEDIATE_KHR};
+    static const char *getPresentModeName(VkPresentModeKHR mode);
+
+   private:
+    void initHeadless(VkExtent2D extent, Swapchain *old);
+    // Reuse `old`'s depth buffer if it's big enough, otherwise allocate one.
+    void initDepth(Swapchain *old);
+
+    bool outOfDate = false;
+    // The last offscreen image handed out when headless.
+    u32 headlessImage = 0;
   };
-}  // namespace ren
\ No newline at end of file
+}  // namespace ren
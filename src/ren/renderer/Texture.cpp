@@ -1,8 +1,10 @@
 #include <ren/renderer/Texture.h>
 #include <ren/renderer/Vulkan.h>
+#include <ren/renderer/UploadQueue.h>
 #include <ren/core/Instrumentation.h>
 
 #include <stb/stb_image.h>
+#include <imgui.h>
 #include <imgui_impl_vulkan.h>
 
 ren::Texture::Texture(const std::string &name, u32 width, u32 height, u8 *pixels)
@@ -16,7 +18,7 @@ ren::Texture::Texture(const std::string &name, u32 width, u32 height, u8 *pixels
 
   ib.setFormat(format);
   ib.setUsage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-  ib.setAllocationUsage(VMA_MEMORY_USAGE_GPU_ONLY);
+  ib.setAllocationUsage(VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
 
 
   this->image = ib.build();
@@ -24,21 +26,9 @@ ren::Texture::Texture(const std::string &name, u32 width, u32 height, u8 *pixels
   // TODO: move to an init function
   auto &vulkan = ren::getVulkan();
 
+  // The copy is batched with the other uploads, and lands before the next frame runs.
   VkDeviceSize imageSize = getWidth() * getHeight() * 4;
-  ren::Buffer stagingBuffer(
-      vulkan, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-  if (pixels != nullptr) stagingBuffer.copyFromHost(pixels, imageSize);
-
-  vulkan.transitionImageLayout(image->getImage(), VK_FORMAT_R8G8B8A8_SRGB,
-                               VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  vulkan.copyBufferToImage(stagingBuffer.getHandle(), image->getImage(),
-                           static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-
-  vulkan.transitionImageLayout(image->getImage(), VK_FORMAT_R8G8B8A8_SRGB,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  ren::UploadQueue::get().uploadImage(*image, pixels, imageSize);
 
   // Texture Sampler
   VkSamplerCreateInfo samplerInfo{};
@@ -66,10 +56,14 @@ ren::Texture::Texture(const std::string &name, u32 width, u32 height, u8 *pixels
     throw std::runtime_error("failed to create texture sampler!");
   }
 
+  bindlessIndex = ren::BindlessTextures::add(image->getImageView(), sampler);
+
 
-  // create the imgui texture ID so we can display it in imgui
-  imguiTextureID = ImGui_ImplVulkan_AddTexture(sampler, image->getImageView(),
-                                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  // create the imgui texture ID so we can display it in imgui (there is no imgui when headless)
+  if (ImGui::GetCurrentContext() != nullptr) {
+    imguiTextureID = ImGui_ImplVulkan_AddTexture(sampler, image->getImageView(),
+                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
 }
 
 
@@ -107,20 +101,28 @@ ren::Texture::Texture(ren::ImageRef image) {
     throw std::runtime_error("failed to create texture sampler!");
   }
 
-  // create the imgui texture ID so we can display it in imgui
-  imguiTextureID = ImGui_ImplVulkan_AddTexture(this->getSampler(), this->getImageView(),
-                                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  bindlessIndex = ren::BindlessTextures::add(image->getImageView(), sampler);
+
+  // create the imgui texture ID so we can display it in imgui (there is no imgui when headless)
+  if (ImGui::GetCurrentContext() != nullptr) {
+    imguiTextureID = ImGui_ImplVulkan_AddTexture(this->getSampler(), this->getImageView(),
+                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
 }
 
 
 
 ren::Texture::~Texture(void) {
   auto &vulkan = ren::getVulkan();
-  // Remove the imgui texture ID first,
-  ImGui_ImplVulkan_RemoveTexture(imguiTextureID);
-
-  // then destroy the sampler.
-  vkDestroySampler(vulkan.device, sampler, nullptr);
+  ren::DescriptorCache::forget((u64)sampler);
+  ren::BindlessTextures::release(bindlessIndex);
+  // Remove the imgui texture ID first, then destroy the sampler. ImGui may
+  // have drawn with both in a frame that's still in flight.
+  ren::DeletionQueue::defer([device = vulkan.device, sampler = sampler,
+                             imguiTextureID = imguiTextureID] {
+    if (imguiTextureID != VK_NULL_HANDLE) ImGui_ImplVulkan_RemoveTexture(imguiTextureID);
+    vkDestroySampler(device, sampler, nullptr);
+  });
   // And release our image reference.
   this->image.reset();
 }
@@ -135,6 +137,7 @@ ren::ref<ren::Texture> ren::Texture::load(const std::string &filename) {
     REN_PROFILE_SCOPE("stbi_load");
     pixels = stbi_load(filename.data(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
   }
+  if (pixels == nullptr) throw std::runtime_error("failed to load texture " + filename);
 
   auto texture = ren::makeRef<ren::Texture>(filename, (u32)texWidth, (u32)texHeight, (u8 *)pixels);
 
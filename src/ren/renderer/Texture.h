@@ -3,6 +3,7 @@
 #include <ren/types.h>
 #include <ren/renderer/Buffer.h>
 #include <ren/renderer/Image.h>
+#include <ren/renderer/BindlessTextures.h>
 #include <ren/core/Instrumentation.h>
 
 namespace ren {
@@ -41,6 +42,10 @@ namespace ren {
 
     VkDescriptorSet getImGui(void) { return imguiTextureID; }
 
+    // The texture's slot in the bindless texture table, for shaders to index
+    // it with. BindlessTextures::INVALID if there was no table.
+    u32 getBindlessIndex(void) const { return bindlessIndex; }
+
 
    private:
     std::string name;
@@ -49,6 +54,7 @@ namespace ren {
     VkSampler sampler = VK_NULL_HANDLE;
 
     VkDescriptorSet imguiTextureID = VK_NULL_HANDLE;
+    u32 bindlessIndex = BindlessTextures::INVALID;
   };
 
   using TextureRef = ref<Texture>;
@@ -0,0 +1,112 @@
+#include <ren/renderer/Timeline.h>
+#include <ren/core/Instrumentation.h>
+
+namespace ren {
+
+  Timeline::Timeline(VkDevice device, VkQueue queue)
+      : device(device)
+      , queue(queue) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore));
+  }
+
+
+  Timeline::~Timeline(void) { vkDestroySemaphore(device, semaphore, nullptr); }
+
+
+  u64 Timeline::getCompleted(void) {
+    u64 value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(device, semaphore, &value));
+    completed.store(value, std::memory_order_release);
+    return value;
+  }
+
+
+  bool Timeline::isComplete(u64 value) {
+    if (value <= completed.load(std::memory_order_acquire)) return true;
+    return value <= getCompleted();
+  }
+
+
+  void Timeline::wait(u64 value) {
+    if (isComplete(value)) return;
+    REN_PROFILE_FUNCTION();
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+    VK_CHECK(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
+    getCompleted();
+  }
+
+
+  // ---- QueueSubmit ---- //
+
+  QueueSubmit &QueueSubmit::add(VkCommandBuffer cmd) {
+    commandBuffers.push_back(cmd);
+    return *this;
+  }
+
+
+  QueueSubmit &QueueSubmit::wait(Timeline &timeline, u64 value, VkPipelineStageFlags stage) {
+    if (value == 0) return *this;
+    waits.push_back(timeline.getHandle());
+    waitValues.push_back(value);
+    waitStages.push_back(stage);
+    return *this;
+  }
+
+
+  QueueSubmit &QueueSubmit::wait(VkSemaphore binary, VkPipelineStageFlags stage) {
+    waits.push_back(binary);
+    // Ignored for binary semaphores.
+    waitValues.push_back(0);
+    waitStages.push_back(stage);
+    return *this;
+  }
+
+
+  QueueSubmit &QueueSubmit::signal(VkSemaphore binary) {
+    signals.push_back(binary);
+    signalValues.push_back(0);
+    return *this;
+  }
+
+
+  u64 QueueSubmit::submit(Timeline &timeline, VkFence fence) {
+    u64 value = timeline.reserve();
+    signals.push_back(timeline.getHandle());
+    signalValues.push_back(value);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<u32>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<u32>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<u32>(waits.size());
+    submitInfo.pWaitSemaphores = waits.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = static_cast<u32>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<u32>(signals.size());
+    submitInfo.pSignalSemaphores = signals.data();
+
+    VK_CHECK(vkQueueSubmit(timeline.getQueue(), 1, &submitInfo, fence));
+    return value;
+  }
+
+}  // namespace ren
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ren/types.h>
+#include <atomic>
+
+namespace ren {
+
+  // A timeline semaphore for one queue. Every submission to the queue signals
+  // the next value, so "has the GPU finished X" is just a comparison against
+  // the value X's submission signaled. Submit through QueueSubmit, and only
+  // from one thread at a time, so the values reach the queue in order.
+  class Timeline {
+   public:
+    Timeline(VkDevice device, VkQueue queue);
+    ~Timeline(void);
+
+    Timeline(const Timeline &) = delete;
+    Timeline &operator=(const Timeline &) = delete;
+
+    VkSemaphore getHandle(void) const { return semaphore; }
+    VkQueue getQueue(void) const { return queue; }
+
+    // The value of the most recent submission.
+    u64 getLastSubmitted(void) const { return lastSubmitted.load(std::memory_order_acquire); }
+    // The highest value the GPU has reached. Asks the driver, but never blocks.
+    u64 getCompleted(void);
+    bool isComplete(u64 value);
+    // Block until the GPU reaches `value`.
+    void wait(u64 value);
+    // Wait for everything submitted so far.
+    void waitIdle(void) { wait(getLastSubmitted()); }
+
+   private:
+    friend struct QueueSubmit;
+    u64 reserve(void) { return lastSubmitted.fetch_add(1, std::memory_order_acq_rel) + 1; }
+
+    VkDevice device;
+    VkQueue queue;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    std::atomic<u64> lastSubmitted = 0;
+    // What getCompleted() last saw, so isComplete() can usually skip the driver.
+    std::atomic<u64> completed = 0;
+  };
+
+
+  // Collects what one vkQueueSubmit waits on and signals, so binary
+  // semaphores (which the swapchain still needs) can be mixed with timelines.
+  struct QueueSubmit {
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    QueueSubmit &add(VkCommandBuffer cmd);
+    // Wait for `timeline` to reach `value` before `stage`. A zero value is skipped.
+    QueueSubmit &wait(Timeline &timeline, u64 value, VkPipelineStageFlags stage);
+    QueueSubmit &wait(VkSemaphore binary, VkPipelineStageFlags stage);
+    QueueSubmit &signal(VkSemaphore binary);
+
+    // Submit to `timeline`'s queue, and return the timeline value that signals
+    // when it's done. `fence` is only for code that can't wait on a timeline.
+    u64 submit(Timeline &timeline, VkFence fence = VK_NULL_HANDLE);
+
+   private:
+    std::vector<VkSemaphore> waits;
+    std::vector<u64> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore> signals;
+    std::vector<u64> signalValues;
+  };
+
+}  // namespace ren
@@ -0,0 +1,399 @@
+#include <ren/renderer/UploadQueue.h>
+#include <ren/renderer/Vulkan.h>
+#include <ren/core/JobSystem.h>
+#include <ren/core/Instrumentation.h>
+#include <cstring>
+
+namespace ren {
+
+  static UploadQueue *g_uploadQueue = nullptr;
+  UploadQueue &UploadQueue::get(void) {
+    if (g_uploadQueue == nullptr) { throw std::runtime_error("UploadQueue not initialized"); }
+    return *g_uploadQueue;
+  }
+
+
+  static u64 alignUp(u64 value, u64 alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+
+  UploadQueue::UploadQueue(VulkanInstance &vulkan)
+      : vulkan(vulkan) {
+    g_uploadQueue = this;
+    separateFamily = vulkan.transfer_queue_family != vulkan.graphics_queue_family;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                     VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = vulkan.transfer_queue_family;
+    VK_CHECK(vkCreateCommandPool(vulkan.device, &poolInfo, nullptr, &pool));
+    if (separateFamily) {
+      poolInfo.queueFamilyIndex = vulkan.graphics_queue_family;
+      VK_CHECK(vkCreateCommandPool(vulkan.device, &poolInfo, nullptr, &graphicsPool));
+    }
+
+    ring = makeBox<Buffer>(vulkan, RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    ring->setName("Staging Ring");
+    ringData = static_cast<u8 *>(ring->map());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vulkan.physical_device, &properties);
+    alignment =
+        std::max<VkDeviceSize>(alignment, properties.limits.optimalBufferCopyOffsetAlignment);
+  }
+
+
+  UploadQueue::~UploadQueue(void) {
+    {
+      std::unique_lock lock(mutex);
+      submit();
+      while (!inFlight.empty()) retire(true);
+      spare.clear();
+    }
+    // Destroying the pools frees every command buffer allocated from them.
+    vkDestroyCommandPool(vulkan.device, pool, nullptr);
+    if (graphicsPool != VK_NULL_HANDLE) vkDestroyCommandPool(vulkan.device, graphicsPool, nullptr);
+    ring.reset();
+    if (g_uploadQueue == this) g_uploadQueue = nullptr;
+  }
+
+
+  void UploadQueue::uploadBuffer(Buffer &dst, const void *data, VkDeviceSize size,
+                                 VkDeviceSize dstOffset) {
+    if (size == 0) return;
+    if (dstOffset + size > dst.getSize()) {
+      throw std::runtime_error("Buffer upload exceeds buffer size");
+    }
+
+    std::unique_lock lock(mutex);
+    // Stage first: making room in the ring can submit the batch being recorded.
+    auto staging = stage(data, size);
+
+    VkBufferCopy region{};
+    region.srcOffset = staging.offset;
+    region.dstOffset = dstOffset;
+    region.size = size;
+
+    // A buffer shared between families can be written anywhere.
+    if (separateFamily && dst.isConcurrent()) {
+      vkCmdCopyBuffer(recording(), staging.buffer, dst.getHandle(), 1, &region);
+      return;
+    }
+
+    // Writing part of a buffer keeps the rest of its contents, so the
+    // transfer queue would have to take ownership of it first. Leave those
+    // updates to the graphics queue.
+    if (!separateFamily || dstOffset != 0 || size != dst.getSize()) {
+      copyOnGraphics(staging.buffer, dst.getHandle(), region);
+      return;
+    }
+
+    auto cmd = recording();
+    vkCmdCopyBuffer(cmd, staging.buffer, dst.getHandle(), 1, &region);
+
+    // Release the buffer to the graphics family. submit() records the acquire.
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = vulkan.transfer_queue_family;
+    barrier.dstQueueFamilyIndex = vulkan.graphics_queue_family;
+    barrier.buffer = dst.getHandle();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    current.bufferAcquires.push_back(barrier);
+  }
+
+
+  void UploadQueue::copyBuffer(const Buffer &src, Buffer &dst, VkDeviceSize size,
+                               VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+    if (size == 0) return;
+
+    std::unique_lock lock(mutex);
+    VkBufferCopy region{};
+    region.srcOffset = srcOffset;
+    region.dstOffset = dstOffset;
+    region.size = size;
+    // `src` was almost certainly written on the graphics queue, which owns it.
+    copyOnGraphics(src.getHandle(), dst.getHandle(), region);
+  }
+
+
+  void UploadQueue::uploadImage(Image &image, const void *data, VkDeviceSize size,
+                                VkImageLayout finalLayout) {
+    std::unique_lock lock(mutex);
+    Staging staging = {};
+    if (data != nullptr) staging = stage(data, size);
+    auto cmd = recording();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.getImage();
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (data != nullptr) {
+      VkBufferImageCopy region{};
+      region.bufferOffset = staging.offset;
+      region.bufferRowLength = 0;
+      region.bufferImageHeight = 0;
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+      region.imageOffset = {0, 0, 0};
+      region.imageExtent = {image.getWidth(), image.getHeight(), 1};
+      vkCmdCopyBufferToImage(cmd, staging.buffer, image.getImage(),
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = finalLayout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    if (!separateFamily) {
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                           &barrier);
+      return;
+    }
+
+    // Release to the graphics family. The layout transition is part of the
+    // transfer, so the acquire in submit() repeats it exactly.
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = vulkan.transfer_queue_family;
+    barrier.dstQueueFamilyIndex = vulkan.graphics_queue_family;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    current.imageAcquires.push_back(barrier);
+  }
+
+
+  u64 UploadQueue::flush(void) {
+    if (!JobSystem::isMainThread()) {
+      throw std::runtime_error("UploadQueue::flush() called off the main thread");
+    }
+    std::unique_lock lock(mutex);
+    return submit();
+  }
+
+
+  bool UploadQueue::isComplete(u64 ticket) {
+    std::unique_lock lock(mutex);
+    retire(false);
+    return ticket <= completedTicket;
+  }
+
+
+  void UploadQueue::wait(u64 ticket) {
+    std::unique_lock lock(mutex);
+    while (completedTicket < ticket && !inFlight.empty()) retire(true);
+  }
+
+
+  void UploadQueue::waitIdle(void) {
+    u64 ticket = flush();
+    wait(ticket);
+  }
+
+
+  void UploadQueue::collect(void) {
+    std::unique_lock lock(mutex);
+    retire(false);
+    REN_PROFILE_COUNTER("Upload Batches In Flight", inFlight.size());
+  }
+
+
+  VkCommandBuffer UploadQueue::recording(void) {
+    if (current.cmd != VK_NULL_HANDLE) return current.cmd;
+
+    if (!spare.empty()) {
+      current.cmd = spare.back().cmd;
+      current.graphicsCmd = spare.back().graphicsCmd;
+      spare.pop_back();
+      vkResetCommandBuffer(current.cmd, 0);
+      if (current.graphicsCmd != VK_NULL_HANDLE) vkResetCommandBuffer(current.graphicsCmd, 0);
+    } else {
+      VkCommandBufferAllocateInfo allocInfo{};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandPool = pool;
+      allocInfo.commandBufferCount = 1;
+      VK_CHECK(vkAllocateCommandBuffers(vulkan.device, &allocInfo, &current.cmd));
+
+      if (separateFamily) {
+        allocInfo.commandPool = graphicsPool;
+        VK_CHECK(vkAllocateCommandBuffers(vulkan.device, &allocInfo, &current.graphicsCmd));
+      }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(current.cmd, &beginInfo));
+    return current.cmd;
+  }
+
+
+  void UploadQueue::copyOnGraphics(VkBuffer src, VkBuffer dst, const VkBufferCopy &region) {
+    auto cmd = recording();
+    if (separateFamily) {
+      current.graphicsCopies.push_back({src, dst, region});
+    } else {
+      vkCmdCopyBuffer(cmd, src, dst, 1, &region);
+    }
+  }
+
+
+  UploadQueue::Staging UploadQueue::stage(const void *data, VkDeviceSize size) {
+    // Big uploads would hog the ring (and stall everyone behind them), so
+    // they get a buffer of their own.
+    bool useRing = size <= RING_SIZE / 4;
+
+    u64 offset = 0;
+    while (useRing) {
+      offset = alignUp(head, alignment);
+      // An upload can't straddle the end of the ring, so skip to the start.
+      if (offset % RING_SIZE + size > RING_SIZE) offset = alignUp(offset, RING_SIZE);
+      if (offset + size - tail <= RING_SIZE) break;
+
+      // The ring is full. Only the main thread may submit, so workers fall
+      // back to a buffer of their own rather than wait on it.
+      if (!JobSystem::isMainThread()) {
+        useRing = false;
+        break;
+      }
+      REN_PROFILE_SCOPE("Wait for Staging Ring");
+      // The batch being recorded may be what's holding the space.
+      submit();
+      if (inFlight.empty()) {
+        // Nothing is using the ring at all, so start again from the beginning.
+        head = tail = 0;
+        continue;
+      }
+      retire(true);
+    }
+
+    if (useRing) {
+      head = offset + size;
+      current.bytes += size;
+      std::memcpy(ringData + offset % RING_SIZE, data, size);
+      return {ring->getHandle(), offset % RING_SIZE};
+    }
+
+    auto scratch = makeBox<Buffer>(vulkan, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    scratch->setName("Upload Scratch");
+    scratch->copyFromHost(data, size);
+    VkBuffer handle = scratch->getHandle();
+    recording();
+    current.bytes += size;
+    current.scratch.push_back(std::move(scratch));
+    return {handle, 0};
+  }
+
+
+  u64 UploadQueue::submit(void) {
+    if (current.cmd == VK_NULL_HANDLE) return 0;
+    REN_PROFILE_FUNCTION();
+
+    // Make the batch's writes visible to whatever is submitted after it.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+    if (!separateFamily) {
+      vkCmdPipelineBarrier(current.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                           nullptr);
+      VK_CHECK(vkEndCommandBuffer(current.cmd));
+
+      current.ticket = QueueSubmit().add(current.cmd).submit(*vulkan.graphics_timeline);
+    } else {
+      // The transfer half only has to signal the graphics half. Its releases
+      // were recorded along with each upload.
+      VK_CHECK(vkEndCommandBuffer(current.cmd));
+      u64 transferValue = QueueSubmit().add(current.cmd).submit(*vulkan.transfer_timeline);
+
+      auto cmd = current.graphicsCmd;
+      VkCommandBufferBeginInfo beginInfo{};
+      beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+      beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+      VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+
+      if (!current.bufferAcquires.empty() || !current.imageAcquires.empty()) {
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                             static_cast<u32>(current.bufferAcquires.size()),
+                             current.bufferAcquires.data(),
+                             static_cast<u32>(current.imageAcquires.size()),
+                             current.imageAcquires.data());
+      }
+      for (auto &copy : current.graphicsCopies) {
+        vkCmdCopyBuffer(cmd, copy.src, copy.dst, 1, &copy.region);
+      }
+      vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                           nullptr);
+      VK_CHECK(vkEndCommandBuffer(cmd));
+
+      // The graphics half can't finish before the transfer half, so its
+      // value covers both.
+      current.ticket = QueueSubmit()
+                           .add(cmd)
+                           .wait(*vulkan.transfer_timeline, transferValue,
+                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+                           .submit(*vulkan.graphics_timeline);
+    }
+
+    REN_PROFILE_COUNTER("Upload Bytes", current.bytes);
+
+    current.ringEnd = head;
+    u64 ticket = current.ticket;
+    inFlight.push_back(std::move(current));
+    current = Batch{};
+    return ticket;
+  }
+
+
+  void UploadQueue::retire(bool block) {
+    while (!inFlight.empty()) {
+      auto &batch = inFlight.front();
+      if (block) {
+        vulkan.graphics_timeline->wait(batch.ticket);
+        block = false;
+      } else if (!vulkan.graphics_timeline->isComplete(batch.ticket)) {
+        break;
+      }
+
+      tail = batch.ringEnd;
+      completedTicket = batch.ticket;
+      batch.scratch.clear();
+      batch.bufferAcquires.clear();
+      batch.imageAcquires.clear();
+      batch.graphicsCopies.clear();
+      batch.bytes = 0;
+      spare.push_back(std::move(batch));
+      inFlight.pop_front();
+    }
+  }
+
+}  // namespace ren
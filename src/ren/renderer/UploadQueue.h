@@ -0,0 +1,134 @@
+#pragma once
+
+#include <ren/types.h>
+#include <ren/renderer/Buffer.h>
+#include <ren/renderer/Image.h>
+#include <deque>
+#include <mutex>
+
+namespace ren {
+
+  class VulkanInstance;
+
+  // Batches host -> device copies into as few submissions as possible.
+  //
+  // Data is written into a persistently mapped staging ring, and the copy is
+  // recorded into the batch currently being built. The batch is submitted by
+  // flush() (the Renderer does this right before it submits each frame), and
+  // its ticket is the graphics timeline value it signals. The ring space a
+  // batch used is reclaimed once the timeline passes that value, so the ring
+  // is only ever waited on when it's full.
+  //
+  // Uploads can be recorded from any thread. Only the main thread submits:
+  // if a worker finds the ring full, that upload gets its own staging buffer
+  // instead of waiting.
+  //
+  // When the device has a transfer queue family separate from graphics, the
+  // batch runs there, alongside rendering. Whole buffers and images are
+  // written on the transfer queue and then handed over to the graphics family
+  // (a release barrier there, a matching acquire on the graphics queue).
+  // Partial buffer updates and device to device copies touch memory the
+  // graphics queue already owns, so they're recorded after the acquires on
+  // the graphics side of the batch.
+  //
+  // Every batch ends (on the graphics queue) in a barrier that makes its
+  // writes visible to all later work there. Anything submitted after the
+  // flush can therefore use the data without further synchronization.
+  class UploadQueue {
+   public:
+    static constexpr VkDeviceSize RING_SIZE = 32 * 1024 * 1024;
+
+    UploadQueue(VulkanInstance &vulkan);
+    ~UploadQueue(void);
+
+    UploadQueue(const UploadQueue &) = delete;
+    UploadQueue &operator=(const UploadQueue &) = delete;
+
+    static UploadQueue &get(void);
+
+    // Copy `size` bytes of `data` into `dst` at `dstOffset`.
+    void uploadBuffer(Buffer &dst, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    // Device to device copy. `src` can be released right away: its buffer is
+    // only destroyed once the copy is done (see DeletionQueue).
+    void copyBuffer(const Buffer &src, Buffer &dst, VkDeviceSize size, VkDeviceSize srcOffset = 0,
+                    VkDeviceSize dstOffset = 0);
+    // Fill the whole of `image` (mip 0, layer 0) with tightly packed `data`, and
+    // leave it in `finalLayout`. A null `data` only transitions the image.
+    void uploadImage(Image &image, const void *data, VkDeviceSize size,
+                     VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Submit everything recorded so far. Returns a ticket for isComplete()
+    // and wait(), or 0 if there was nothing to submit. Main thread only. The
+    // ticket is a graphics timeline value, so it can also be waited on by
+    // other submissions.
+    u64 flush(void);
+    bool isComplete(u64 ticket);
+    void wait(u64 ticket);
+    // Flush, and wait for every upload to land.
+    void waitIdle(void);
+
+    // Reclaim the staging space of any batches that have finished. Never blocks.
+    void collect(void);
+
+   private:
+    struct GraphicsCopy {
+      VkBuffer src;
+      VkBuffer dst;
+      VkBufferCopy region;
+    };
+
+    struct Batch {
+      u64 ticket = 0;
+      VkCommandBuffer cmd = VK_NULL_HANDLE;
+      // Only used with a separate transfer family: the graphics queue's half
+      // of the batch, which waits on the transfer half's timeline value.
+      VkCommandBuffer graphicsCmd = VK_NULL_HANDLE;
+      std::vector<VkBufferMemoryBarrier> bufferAcquires;
+      std::vector<VkImageMemoryBarrier> imageAcquires;
+      std::vector<GraphicsCopy> graphicsCopies;
+      // The ring's head when the batch was submitted. Everything before it is
+      // free once the ticket has been reached.
+      u64 ringEnd = 0;
+      VkDeviceSize bytes = 0;
+      // Staging buffers for uploads that didn't go through the ring.
+      std::vector<box<Buffer>> scratch;
+    };
+
+    struct Staging {
+      VkBuffer buffer;
+      VkDeviceSize offset;
+    };
+
+    // Note: you must already own lock on mutex for all of these.
+    VkCommandBuffer recording(void);
+    // Copy on the graphics queue: straight into the batch if that's where it
+    // runs anyway, otherwise after the batch's acquires.
+    void copyOnGraphics(VkBuffer src, VkBuffer dst, const VkBufferCopy &region);
+    // Copy `data` somewhere the GPU can read it from. May submit and wait if the ring is full.
+    Staging stage(const void *data, VkDeviceSize size);
+    u64 submit(void);
+    void retire(bool block);
+
+    VulkanInstance &vulkan;
+    std::mutex mutex;
+    // True when uploads run on a different queue family than rendering.
+    bool separateFamily = false;
+    VkCommandPool pool = VK_NULL_HANDLE;
+    VkCommandPool graphicsPool = VK_NULL_HANDLE;
+
+    box<Buffer> ring;
+    u8 *ringData = nullptr;
+    // Monotonic byte counters. The physical offset is counter % RING_SIZE.
+    u64 head = 0;
+    u64 tail = 0;
+    VkDeviceSize alignment = 16;
+
+    // The batch being recorded (cmd is null until something is recorded).
+    Batch current;
+    std::deque<Batch> inFlight;
+    // Finished batches, kept around to reuse their command buffers.
+    std::vector<Batch> spare;
+    u64 completedTicket = 0;
+  };
+
+}  // namespace ren
@@ -35,17 +35,24 @@ ren::VulkanInstance &ren::getVulkan(void) {
   return *g_vulkan_instance;
 }
 
-ren::VulkanInstance::VulkanInstance(SDL_Window *window) {
+ren::VulkanInstance::VulkanInstance(SDL_Window *window, VkExtent2D headlessExtent,
+                                    bool directWrites, const std::string &pipelineCachePath) {
   this->window = window;
+  this->directWrites = directWrites;
+  this->pipelineCachePath = pipelineCachePath;
   if (g_vulkan_instance != nullptr) {
     throw std::runtime_error("Vulkan instance already initialized");
   }
   g_vulkan_instance = this;
 
-  int width, height;
-  SDL_Vulkan_GetDrawableSize(window, &width, &height);
-  this->extent.width = width;
-  this->extent.height = height;
+  if (window != nullptr) {
+    int width, height;
+    SDL_Vulkan_GetDrawableSize(window, &width, &height);
+    this->extent.width = width;
+    this->extent.height = height;
+  } else {
+    this->extent = headlessExtent;
+  }
 
   init_instance();
 
@@ -84,9 +91,9 @@ VkCommandBuffer ren::VulkanInstance::beginFrame(void) {
   }
 
   // Acquire the next image from the swapchain
-  FrameData *frameData = swapchain->acquireNextFrame();
+  FrameData *frameData = &ren::getFrameData();
 
-  if (frameData == nullptr) {
+  if (!swapchain->acquireNextImage(*frameData)) {
     recreate_swapchain();
     return VK_NULL_HANDLE;
   }
@@ -127,7 +134,7 @@ VkCommandBuffer ren::VulkanInstance::beginFrame(void) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass->getHandle();
-  renderPassInfo.framebuffer = frameData->renderFramebuffer;
+  renderPassInfo.framebuffer = frameData->image->renderFramebuffer;
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = swapchain->renderExtent;
 
@@ -191,7 +198,7 @@ void ren::VulkanInstance::endFrame(void) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = displayPass->getHandle();
-  renderPassInfo.framebuffer = frame.deviceFramebuffer;
+  renderPassInfo.framebuffer = frame.image->framebuffer;
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = swapchain->deviceExtent;
   // setup the clear values
@@ -223,7 +230,7 @@ void ren::VulkanInstance::endFrame(void) {
   presentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
   presentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   presentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  presentBarrier.image = frame.deviceImage->getImage();
+  presentBarrier.image = frame.image->deviceImage->getImage();
   presentBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   presentBarrier.subresourceRange.baseMipLevel = 0;
   presentBarrier.subresourceRange.levelCount = 1;
@@ -244,49 +251,20 @@ void ren::VulkanInstance::endFrame(void) {
   }
 
 
-  VkSemaphore signalSemaphores[] = {frame.renderFinishedSemaphore};
-
   {
     REN_PROFILE_SCOPE("Submit Graphics Queue");
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    VkSemaphore waitSemaphores[] = {frame.imageAvailableSemaphore};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &frame.commandBuffer;
-
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-
-    if (vkQueueSubmit(graphics_queue, 1, &submitInfo, frame.inFlightFence) != VK_SUCCESS) {
-      throw std::runtime_error("failed to submit draw command buffer!");
-    }
+    frame.submitValue = QueueSubmit()
+                            .add(frame.commandBuffer)
+                            .wait(frame.imageAvailableSemaphore,
+                                  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT)
+                            .signal(frame.image->renderFinishedSemaphore)
+                            .submit(*graphics_timeline);
   }
 
 
   {
     REN_PROFILE_SCOPE("Presentation");
-
-    // Presentation
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-
-    VkSwapchainKHR swapChains[] = {swapchain->swapchain};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    uint32_t index = frame.frameIndex;  // we need a u32
-    presentInfo.pImageIndices = &index;
-
-    presentInfo.pResults = nullptr;  // Optional
-    vkQueuePresentKHR(graphics_queue, &presentInfo);
+    swapchain->present(frame);
   }
 }
 
@@ -299,9 +277,12 @@ void ren::VulkanInstance::init_instance(void) {
   vkb::InstanceBuilder builder;
 
   // make the vulkan instance, with basic debug features
+  // Headless instances don't enable the surface extensions, so they run on
+  // ICDs that have no WSI at all (lavapipe in CI, for example).
   auto inst_ret = builder.set_app_name("Example Vulkan Application")
                       .request_validation_layers(true)
-                      .require_api_version(1, 1, 0)
+                      .require_api_version(1, 2, 0)
+                      .set_headless(isHeadless())
                       .build();
 
   if (!inst_ret) {
@@ -320,7 +301,7 @@ void ren::VulkanInstance::init_instance(void) {
   this->instance = vkb_inst.instance;
 
   // Create the vulkan surface from SDL
-  SDL_Vulkan_CreateSurface(window, instance, &surface);
+  if (!isHeadless()) SDL_Vulkan_CreateSurface(window, instance, &surface);
 
   // And select the GPU to use (I think we'd need to figure out how to pick the
   // best one if you have multiple GPUs, but I don't so this is fine for now)
@@ -330,11 +311,28 @@ void ren::VulkanInstance::init_instance(void) {
   requiredFeatures.samplerAnisotropy = VK_TRUE;  // Enable anisotropic filtering
   requiredFeatures.fillModeNonSolid = VK_TRUE;
 
-  vkb::PhysicalDevice physicalDevice = selector.set_minimum_version(1, 1)
-                                           .set_required_features(requiredFeatures)
-                                           .set_surface(surface)
-                                           .select()
-                                           .value();
+  // Timeline semaphores order every submission (see Timeline).
+  VkPhysicalDeviceVulkan12Features requiredFeatures12 = {};
+  requiredFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  requiredFeatures12.timelineSemaphore = VK_TRUE;
+  // Descriptor indexing, for the bindless texture table (see BindlessTextures).
+  requiredFeatures12.descriptorIndexing = VK_TRUE;
+  requiredFeatures12.runtimeDescriptorArray = VK_TRUE;
+  requiredFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  requiredFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+  requiredFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  requiredFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+  selector.set_minimum_version(1, 2)
+      .set_required_features(requiredFeatures)
+      .set_required_features_12(requiredFeatures12);
+  if (isHeadless()) {
+    // We never present, and a software rasterizer (a CPU device type) is fine.
+    selector.require_present(false).allow_any_gpu_device_type(true);
+  } else {
+    selector.set_surface(surface);
+  }
+  vkb::PhysicalDevice physicalDevice = selector.select().value();
   fmt::print("Selected physical device: {}\n", physicalDevice.name);
   this->physical_device = physicalDevice.physical_device;
 
@@ -346,6 +344,40 @@ void ren::VulkanInstance::init_instance(void) {
   this->graphics_queue_family = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
   fmt::print("Created graphics queue with family index: {}\n", this->graphics_queue_family);
 
+  // Prefer a transfer-only family (the copy engine on discrete GPUs), then any
+  // family other than graphics that can transfer. Without either, uploads
+  // share the graphics queue.
+  if (auto queue = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer)) {
+    this->transfer_queue = queue.value();
+    this->transfer_queue_family =
+        vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+  } else if (auto queue = vkbDevice.get_queue(vkb::QueueType::transfer)) {
+    this->transfer_queue = queue.value();
+    this->transfer_queue_family = vkbDevice.get_queue_index(vkb::QueueType::transfer).value();
+  } else {
+    this->transfer_queue = this->graphics_queue;
+    this->transfer_queue_family = this->graphics_queue_family;
+  }
+  fmt::print("Using transfer queue with family index: {}\n", this->transfer_queue_family);
+
+  // Compute wants a family without graphics, so it can overlap rasterization.
+  if (auto queue = vkbDevice.get_dedicated_queue(vkb::QueueType::compute)) {
+    this->compute_queue = queue.value();
+    this->compute_queue_family =
+        vkbDevice.get_dedicated_queue_index(vkb::QueueType::compute).value();
+  } else if (auto queue = vkbDevice.get_queue(vkb::QueueType::compute)) {
+    this->compute_queue = queue.value();
+    this->compute_queue_family = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
+  } else {
+    this->compute_queue = this->graphics_queue;
+    this->compute_queue_family = this->graphics_queue_family;
+  }
+  fmt::print("Using compute queue with family index: {}\n", this->compute_queue_family);
+
+  this->graphics_timeline = timelineFor(this->graphics_queue);
+  this->transfer_timeline = timelineFor(this->transfer_queue);
+  this->compute_timeline = timelineFor(this->compute_queue);
+
 
   // Now that we have an instance, allocate the vulkan allocator
   VmaVulkanFunctions vulkanFunctions = {};
@@ -361,6 +393,9 @@ void ren::VulkanInstance::init_instance(void) {
   allocatorCreateInfo.pVulkanFunctions = &vulkanFunctions;
 
   VkResult res = vmaCreateAllocator(&allocatorCreateInfo, &allocator);
+  this->memory = makeBox<MemoryPools>(*this, directWrites);
+  this->layouts = makeBox<LayoutCache>(*this);
+  this->pipelineCache = makeBox<PipelineCache>(*this, pipelineCachePath);
 
   VkPhysicalDeviceProperties props;
   vkGetPhysicalDeviceProperties(physicalDevice, &props);
@@ -381,10 +416,15 @@ ren::VulkanInstance::~VulkanInstance() {
 
   // Command Pool
   vkDestroyCommandPool(device, commandPool, nullptr);
+  timelines.clear();
 
 
   vkDestroySurfaceKHR(instance, surface, nullptr);
 
+  // Written back to disk here, after every pipeline of the run was created.
+  pipelineCache.reset();
+  layouts.reset();
+  memory.reset();
   vmaDestroyAllocator(allocator);
 
 
@@ -395,6 +435,15 @@ ren::VulkanInstance::~VulkanInstance() {
 }
 
 
+ren::Timeline *ren::VulkanInstance::timelineFor(VkQueue queue) {
+  for (auto &timeline : timelines) {
+    if (timeline->getQueue() == queue) return timeline.get();
+  }
+  timelines.push_back(makeBox<Timeline>(device, queue));
+  return timelines.back().get();
+}
+
+
 void ren::VulkanInstance::init_swapchain(void) {
   // REN_PROFILE_FUNCTION();
   // this->swapchain.reset();
@@ -648,14 +697,9 @@ VkCommandBuffer ren::VulkanInstance::beginSingleTimeCommands() {
 void ren::VulkanInstance::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkEndCommandBuffer(commandBuffer);
 
-  VkCommandBufferAllocateInfo allocInfo{};
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffer;
-
-  vkQueueSubmit(graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphics_queue);
+  // Only wait for this submission, not for every frame in flight.
+  u64 value = QueueSubmit().add(commandBuffer).submit(*graphics_timeline);
+  graphics_timeline->wait(value);
 
   vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
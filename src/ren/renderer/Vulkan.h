@@ -8,6 +8,13 @@
 #include <ren/renderer/Buffer.h>
 #include <ren/renderer/RenderPass.h>
 #include <ren/renderer/Swapchain.h>
+#include <ren/renderer/Timeline.h>
+#include <ren/renderer/DeletionQueue.h>
+#include <ren/renderer/MemoryPools.h>
+#include <ren/renderer/LayoutCache.h>
+#include <ren/renderer/PipelineCache.h>
+#include <ren/renderer/Descriptors.h>
+#include <ren/renderer/BindlessTextures.h>
 #include <ren/renderer/pipelines/DisplayPipeline.h>
 #include <ren/core/Instrumentation.h>
 
@@ -87,7 +94,12 @@ namespace ren {
   // This class also contains the physical device, device, and surface.
   class VulkanInstance {
    public:
-    VulkanInstance(SDL_Window *window);
+    // If `window` is null, the instance is headless: there is no surface, and
+    // `headlessExtent` is the size of the offscreen targets we render to.
+    // `directWrites` is passed on to MemoryPools, `pipelineCachePath` to
+    // PipelineCache (empty keeps the pipeline cache in memory).
+    VulkanInstance(SDL_Window *window, VkExtent2D headlessExtent = {0, 0},
+                   bool directWrites = true, const std::string &pipelineCachePath = "");
 
     ~VulkanInstance();
 
@@ -101,12 +113,36 @@ namespace ren {
     VkDevice device = VK_NULL_HANDLE;
     VkQueue graphics_queue = VK_NULL_HANDLE;
     u32 graphics_queue_family = 0;
+    // Where uploads are submitted. This is a queue family of its own when the
+    // device has one, and the graphics queue otherwise.
+    VkQueue transfer_queue = VK_NULL_HANDLE;
+    u32 transfer_queue_family = 0;
+    // Where compute work runs asynchronously to rendering. Same fallback as above.
+    VkQueue compute_queue = VK_NULL_HANDLE;
+    u32 compute_queue_family = 0;
+
+    // One timeline semaphore per queue, signaled by every submission to it.
+    // Queues that turn out to be the same VkQueue share a timeline.
+    Timeline *graphics_timeline = nullptr;
+    Timeline *transfer_timeline = nullptr;
+    Timeline *compute_timeline = nullptr;
 
     // ---- Memory Allocator ---- //
     VmaAllocator allocator;
+    // Where buffers are sub-allocated from, by MemoryCategory.
+    box<MemoryPools> memory;
+    bool directWrites = true;
+
+    // Every pipeline's layouts, shared between the pipelines that can.
+    box<LayoutCache> layouts;
+    // Pass pipelineCache->getHandle() to every pipeline creation.
+    box<PipelineCache> pipelineCache;
+    // Where the pipeline cache is kept between runs, or "" for none.
+    std::string pipelineCachePath;
 
     // The surface is the window that we render to (we link against SDL2)
     VkSurfaceKHR surface = VK_NULL_HANDLE;
+    inline bool isHeadless(void) const { return window == nullptr; }
     VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
 
     // ---- Swapchain ---- //
@@ -189,6 +225,7 @@ namespace ren {
 
    private:
     void init_instance(void);
+    Timeline *timelineFor(VkQueue queue);
     void init_renderpass(void);
     void init_swapchain(void);
     void init_framebuffers(void);
@@ -207,6 +244,8 @@ namespace ren {
 
 
     u32 find_memory_type(u32 typeFilter, VkMemoryPropertyFlags properties);
+
+    std::vector<box<Timeline>> timelines;
   };
 
 
@@ -0,0 +1,48 @@
+#include <ren/renderer/pipelines/ComputePipeline.h>
+#include <ren/renderer/Vulkan.h>
+
+namespace ren {
+
+  ComputePipeline::ComputePipeline(const std::string &shaderPath,
+                                   const std::vector<VkDescriptorSetLayout> &setLayouts) {
+    REN_PROFILE_FUNCTION();
+    this->bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+    auto &vulkan = ren::getVulkan();
+
+    this->shader = makeRef<ren::ComputeShader>(shaderPath);
+
+    // ---- Pipeline Layout ---- //
+    buildLayout({shader}, setLayouts);
+
+    // ---- Pipeline ---- //
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = shader->getHandle();
+    stageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(vulkan.device, vulkan.pipelineCache->getHandle(), 1,
+                                 &pipelineInfo, nullptr, &this->pipeline) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create compute pipeline!");
+    }
+  }
+
+
+  void ComputePipeline::dispatch(VkCommandBuffer cmd, u32 x, u32 y, u32 z) const {
+    vkCmdDispatch(cmd, x, y, z);
+  }
+
+
+  void ComputePipeline::dispatchFor(VkCommandBuffer cmd, u32 count, u32 groupSize) const {
+    if (count == 0) return;
+    dispatch(cmd, (count + groupSize - 1) / groupSize);
+  }
+
+}  // namespace ren
@@ -0,0 +1,31 @@
+#pragma once
+
+
+#include <ren/renderer/pipelines/VulkanPipeline.h>
+#include <ren/renderer/Shader.h>
+
+namespace ren {
+
+  // A pipeline with a single compute shader. Record into a command buffer from
+  // Renderer::beginCompute() to run it asynchronously to the frame's
+  // rasterization, or into any other command buffer to run it inline.
+  class ComputePipeline : public VulkanPipeline {
+   public:
+    // `shaderPath` is a compiled .spv. Its sets and push constants are
+    // reflected (see VulkanPipeline::buildLayout).
+    ComputePipeline(const std::string &shaderPath,
+                    const std::vector<VkDescriptorSetLayout> &setLayouts = {});
+
+    ~ComputePipeline() override = default;
+
+    // Dispatch a grid of workgroups.
+    void dispatch(VkCommandBuffer cmd, u32 x, u32 y = 1, u32 z = 1) const;
+    // Dispatch enough workgroups of `groupSize` (the shader's local_size_x) to
+    // cover `count` invocations. The shader has to ignore the ones past the end.
+    void dispatchFor(VkCommandBuffer cmd, u32 count, u32 groupSize) const;
+
+   protected:
+    ref<ComputeShader> shader;
+  };
+
+}  // namespace ren
@@ -103,31 +103,8 @@ namespace ren {
     colorBlending.blendConstants[2] = 0.0f;  // Optional
     colorBlending.blendConstants[3] = 0.0f;  // Optional
 
-    // ---- Push Constants ---- //
-    VkPushConstantRange pushConstants{};
-    // this push constant range starts at the beginning
-    pushConstants.offset = 0;
-    // this push constant range takes up the size of a MeshPushConstants struct
-    pushConstants.size = sizeof(ren::MeshPushConstants);
-    // this push constant range is accessible only in the vertex shader
-    pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-
-
-
-    // Create the pipeline layout
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pSetLayouts = NULL;                    // &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;            // Optional
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;  // Optional
-
-    if (vkCreatePipelineLayout(vulkan.device, &pipelineLayoutInfo, nullptr,
-                               &this->pipelineLayout) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create pipeline layout!");
-    }
+    // ---- Pipeline Layout ---- //
+    buildLayout({vertexShader, fragmentShader});
 
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT,
                                                  VK_DYNAMIC_STATE_SCISSOR};
@@ -185,8 +162,8 @@ namespace ren {
     pipelineInfo.layout = pipelineLayout;
 
 
-    if (vkCreateGraphicsPipelines(vulkan.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &this->pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(vulkan.device, vulkan.pipelineCache->getHandle(), 1,
+                                  &pipelineInfo, nullptr, &this->pipeline) != VK_SUCCESS) {
       throw std::runtime_error("failed to create graphics pipeline!");
     }
   }
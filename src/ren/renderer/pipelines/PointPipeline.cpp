@@ -1,9 +1,10 @@
 #include <ren/renderer/pipelines/PointPipeline.h>
 #include <ren/renderer/Vulkan.h>
+#include <ren/renderer/Renderer.h>
 #include <ren/renderer/Shader.h>
 namespace ren {
 
-  PointPipeline::PointPipeline(VkDescriptorSetLayout descriptorSetLayout) {
+  PointPipeline::PointPipeline(void) {
     this->bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     auto &vulkan = ren::getVulkan();
 
@@ -11,20 +12,18 @@ namespace ren {
     this->fragmentShader =
         makeRef<ren::Shader>("shaders/point.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
-    auto bindingDesc = ren::Vertex::get_binding_description();
-    auto attributeDescs = ren::Vertex::get_attribute_descriptions();
     // ---- Vertex Input Create Info ---- //
+    // There are no vertex buffers: the shader reads the particle storage
+    // buffer (set 0) with gl_VertexIndex.
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
-    vertexInputInfo.vertexAttributeDescriptionCount = attributeDescs.size();
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescs.data();
+    vertexInputInfo.vertexBindingDescriptionCount = 0;
+    vertexInputInfo.vertexAttributeDescriptionCount = 0;
 
     // ---- Input Assembly Create Info ---- //
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
     // ---- Viewport State Create Info ---- //
@@ -39,9 +38,9 @@ namespace ren {
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;  // Discarding fragments is not allowed
-    rasterizer.polygonMode = VK_POLYGON_MODE_POINT;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f;  // Optional
@@ -52,7 +51,8 @@ namespace ren {
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
+    // Points are blended, so they're tested against the scene but don't occlude each other.
+    depthStencil.depthWriteEnable = VK_FALSE;
     depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.minDepthBounds = 0.0f;  // Optional
@@ -77,13 +77,14 @@ namespace ren {
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;   // Optional
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;  // Optional
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;              // Optional
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;   // Optional
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;  // Optional
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;              // Optional
+    // Additive, so dense parts of the cloud glow.
+    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 
     // ---- Color Blending Create Info ---- //
@@ -98,31 +99,9 @@ namespace ren {
     colorBlending.blendConstants[2] = 0.0f;  // Optional
     colorBlending.blendConstants[3] = 0.0f;  // Optional
 
-    // ---- Push Constants ---- //
-    VkPushConstantRange pushConstants{};
-    // this push constant range starts at the beginning
-    pushConstants.offset = 0;
-    // this push constant range takes up the size of a MeshPushConstants struct
-    pushConstants.size = sizeof(ren::MeshPushConstants);
-    // this push constant range is accessible only in the vertex shader
-    pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-
-
-
-    // Create the pipeline layout
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;            // Optional
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;  // Optional
-
-    if (vkCreatePipelineLayout(vulkan.device, &pipelineLayoutInfo, nullptr,
-                               &this->pipelineLayout) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create pipeline layout!");
-    }
+    // ---- Pipeline Layout ---- //
+    // Reflected from the shaders: the particle storage buffer, and the MeshPushConstants.
+    buildLayout({vertexShader, fragmentShader});
 
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT,
                                                  VK_DYNAMIC_STATE_SCISSOR};
@@ -161,7 +140,7 @@ namespace ren {
     // Then we reference all of the structures describing the fixed-function stage.
     pipelineInfo.layout = pipelineLayout;
     // After that comes the pipeline layout, which is a Vulkan handle rather than a struct pointer.
-    pipelineInfo.renderPass = vulkan.renderPass->getHandle();
+    pipelineInfo.renderPass = Renderer::get().getRenderPass().getHandle();
     pipelineInfo.subpass = 0;
     // Required for compat
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;  // Optional
@@ -180,8 +159,8 @@ namespace ren {
     pipelineInfo.layout = pipelineLayout;
 
 
-    if (vkCreateGraphicsPipelines(vulkan.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &this->pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(vulkan.device, vulkan.pipelineCache->getHandle(), 1,
+                                  &pipelineInfo, nullptr, &this->pipeline) != VK_SUCCESS) {
       throw std::runtime_error("failed to create graphics pipeline!");
     }
   }
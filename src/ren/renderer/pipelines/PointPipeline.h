@@ -6,9 +6,11 @@
 
 namespace ren {
 
+  // Draws one blended point per particle, out of the particle storage buffer
+  // at set 0 binding 0 (see ParticleSystem).
   class PointPipeline : public VulkanPipeline {
    public:
-    PointPipeline(VkDescriptorSetLayout descriptorSetLayout);
+    PointPipeline(void);
 
     ~PointPipeline() override = default;
 
@@ -1,5 +1,6 @@
 #include <ren/renderer/pipelines/StandardPipeline.h>
 #include <ren/renderer/Vulkan.h>
+#include <ren/renderer/Renderer.h>
 #include <ren/renderer/Shader.h>
 namespace ren {
 
@@ -11,14 +12,31 @@ namespace ren {
     this->vertexShader = vertexShader;
     this->fragmentShader = fragmentShader;
 
+    // Only the Vertex attributes the vertex shader actually reads.
     auto bindingDesc = ren::Vertex::get_binding_description();
-    auto attributeDescs = ren::Vertex::get_attribute_descriptions();
+    std::vector<VkVertexInputAttributeDescription> attributeDescs;
+    for (auto &input : vertexShader->getReflection().inputs) {
+      bool found = false;
+      for (auto &attribute : ren::Vertex::get_attribute_descriptions()) {
+        if (attribute.location != input.location) continue;
+        if (attribute.format != input.format) {
+          throw std::runtime_error(fmt::format("{} reads location {} as the wrong format",
+                                               vertexShader->getFilename(), input.location));
+        }
+        attributeDescs.push_back(attribute);
+        found = true;
+      }
+      if (!found) {
+        throw std::runtime_error(fmt::format("{} reads location {}, which Vertex doesn't have",
+                                             vertexShader->getFilename(), input.location));
+      }
+    }
     // ---- Vertex Input Create Info ---- //
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
-    vertexInputInfo.vertexAttributeDescriptionCount = attributeDescs.size();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<u32>(attributeDescs.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescs.data();
 
     // ---- Input Assembly Create Info ---- //
@@ -98,31 +116,9 @@ namespace ren {
     colorBlending.blendConstants[2] = 0.0f;  // Optional
     colorBlending.blendConstants[3] = 0.0f;  // Optional
 
-    // ---- Push Constants ---- //
-    VkPushConstantRange pushConstants{};
-    // this push constant range starts at the beginning
-    pushConstants.offset = 0;
-    // this push constant range takes up the size of a MeshPushConstants struct
-    pushConstants.size = sizeof(ren::MeshPushConstants);
-    // this push constant range is accessible only in the vertex shader
-    pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-
-
-
-    // Create the pipeline layout
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;            // Optional
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;  // Optional
-
-    if (vkCreatePipelineLayout(vulkan.device, &pipelineLayoutInfo, nullptr,
-                               &this->pipelineLayout) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create pipeline layout!");
-    }
+    // ---- Pipeline Layout ---- //
+    // Reflected from the shaders, except for the set we were given.
+    buildLayout({vertexShader, fragmentShader}, {descriptorSetLayout});
 
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT,
                                                  VK_DYNAMIC_STATE_SCISSOR};
@@ -161,7 +157,7 @@ namespace ren {
     // Then we reference all of the structures describing the fixed-function stage.
     pipelineInfo.layout = pipelineLayout;
     // After that comes the pipeline layout, which is a Vulkan handle rather than a struct pointer.
-    pipelineInfo.renderPass = vulkan.renderPass->getHandle();
+    pipelineInfo.renderPass = Renderer::get().getRenderPass().getHandle();
     pipelineInfo.subpass = 0;
     // Required for compat
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;  // Optional
@@ -180,8 +176,8 @@ namespace ren {
     pipelineInfo.layout = pipelineLayout;
 
 
-    if (vkCreateGraphicsPipelines(vulkan.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &this->pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(vulkan.device, vulkan.pipelineCache->getHandle(), 1,
+                                  &pipelineInfo, nullptr, &this->pipeline) != VK_SUCCESS) {
       throw std::runtime_error("failed to create graphics pipeline!");
     }
   }
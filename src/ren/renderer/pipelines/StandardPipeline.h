@@ -6,10 +6,13 @@
 
 namespace ren {
 
+  // Draws Vertex geometry. The layout is reflected from the shaders, but set
+  // 0's layout can be given instead (it has to be if it's a runtime array,
+  // like the bindless texture table).
   class StandardPipeline : public VulkanPipeline {
    public:
     StandardPipeline(ref<Shader> vertexShader, ref<Shader> fragmentShader,
-                     VkDescriptorSetLayout descriptorSetLayout);
+                     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE);
 
     ~StandardPipeline() override = default;
 
@@ -1,6 +1,8 @@
 #include <ren/renderer/pipelines/VulkanPipeline.h>
 #include <ren/renderer/Vulkan.h>
 #include "vulkan/vulkan_core.h"
+#include <algorithm>
+#include <map>
 
 
 
@@ -9,13 +11,94 @@ ren::VulkanPipeline::~VulkanPipeline() { cleanup(); }
 void ren::VulkanPipeline::cleanup(void) {
   auto &vulkan = ren::getVulkan();
 
-  if (pipeline != VK_NULL_HANDLE) {
-    vkDestroyPipeline(vulkan.device, pipeline, nullptr);
-    pipeline = VK_NULL_HANDLE;
+  // Frames in flight may still be bound to it. The layout belongs to the LayoutCache.
+  ren::DeletionQueue::defer([device = vulkan.device, pipeline = pipeline] {
+    if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipeline, nullptr);
+  });
+  pipeline = VK_NULL_HANDLE;
+  pipelineLayout = VK_NULL_HANDLE;
+}
+
+
+void ren::VulkanPipeline::buildLayout(const std::vector<ref<Shader>> &shaders,
+                                      const std::vector<VkDescriptorSetLayout> &given) {
+  auto &vulkan = ren::getVulkan();
+
+  // ---- Merge the shaders' reflection ---- //
+  std::map<u32, std::vector<VkDescriptorSetLayoutBinding>> sets;
+  u32 begin = UINT32_MAX, end = 0;
+  pushConstantRange = {};
+  for (auto &shader : shaders) {
+    auto &reflection = shader->getReflection();
+    for (auto &[set, bindings] : reflection.sets) {
+      auto &merged = sets[set];
+      for (auto &binding : bindings) {
+        auto it = std::find_if(merged.begin(), merged.end(),
+                               [&](auto &other) { return other.binding == binding.binding; });
+        if (it == merged.end()) {
+          merged.push_back(binding);
+          continue;
+        }
+        if (it->descriptorType != binding.descriptorType ||
+            it->descriptorCount != binding.descriptorCount) {
+          throw std::runtime_error(
+              fmt::format("{} disagrees with the other shaders about set {} binding {}",
+                          shader->getFilename(), set, binding.binding));
+        }
+        it->stageFlags |= binding.stageFlags;
+      }
+    }
+
+    if (reflection.pushConstantSize > 0) {
+      begin = std::min(begin, reflection.pushConstantOffset);
+      end = std::max(end, reflection.pushConstantOffset + reflection.pushConstantSize);
+      pushConstantRange.stageFlags |= shader->getStage();
+    }
+  }
+  if (end > 0) {
+    pushConstantRange.offset = begin;
+    pushConstantRange.size = end - begin;
   }
 
-  if (pipelineLayout != VK_NULL_HANDLE) {
-    vkDestroyPipelineLayout(vulkan.device, pipelineLayout, nullptr);
-    pipelineLayout = VK_NULL_HANDLE;
+  // ---- Layouts ---- //
+  // Sets no shader uses (below one that is used) get an empty layout.
+  u32 setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+  setCount = std::max(setCount, static_cast<u32>(given.size()));
+  setLayouts.assign(setCount, VK_NULL_HANDLE);
+  for (u32 i = 0; i < setCount; i++) {
+    if (i < given.size() && given[i] != VK_NULL_HANDLE) {
+      setLayouts[i] = given[i];
+      continue;
+    }
+    auto &bindings = sets[i];
+    for (auto &binding : bindings) {
+      if (binding.descriptorCount == 0) {
+        throw std::runtime_error(
+            fmt::format("Set {} binding {} is a runtime array, so the pipeline needs its layout",
+                        i, binding.binding));
+      }
+    }
+    setLayouts[i] = vulkan.layouts->getSetLayout(bindings);
+  }
+
+  std::vector<VkPushConstantRange> ranges;
+  if (pushConstantRange.size > 0) ranges.push_back(pushConstantRange);
+  pipelineLayout = vulkan.layouts->getPipelineLayout(setLayouts, ranges);
+}
+
+
+void ren::VulkanPipeline::bindDescriptorSet(VkCommandBuffer cmd, VkDescriptorSet set,
+                                            u32 index) const {
+  vkCmdBindDescriptorSets(cmd, bindPoint, getLayout(), index, 1, &set, 0, nullptr);
+}
+
+
+void ren::VulkanPipeline::pushConstants(VkCommandBuffer cmd, const void *data, u32 size) const {
+  u32 offset = pushConstantRange.offset;
+  if (size > offset + pushConstantRange.size) {
+    throw std::runtime_error("Push constants are larger than the pipeline's range");
   }
+  if (size <= offset) return;
+  vkCmdPushConstants(cmd, getLayout(), pushConstantRange.stageFlags, offset, size - offset,
+                     static_cast<const u8 *>(data) + offset);
 }
\ No newline at end of file
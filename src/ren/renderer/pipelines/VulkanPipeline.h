@@ -13,6 +13,9 @@ namespace ren {
   // This is the base class for all Vulkan pipelines.
   // It is intentionally designed to be generic, and requires
   // subclasses actually construct the pipeline.
+  //
+  // The layout isn't written by hand: buildLayout() reflects it out of the
+  // shaders and gets it from the LayoutCache, which owns it.
   class VulkanPipeline {
    public:
     VulkanPipeline() = default;
@@ -35,6 +38,16 @@ namespace ren {
       vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
     }
 
+    void bindDescriptorSet(VkCommandBuffer cmd, VkDescriptorSet set, u32 index = 0) const;
+
+    // Push the shaders' push constant block, with the stages that declare it.
+    template <typename T>
+    void pushConstants(VkCommandBuffer cmd, const T &constants) const {
+      pushConstants(cmd, &constants, sizeof(T));
+    }
+    // `data` starts at byte 0 of the block. Throws if it's bigger than the block.
+    void pushConstants(VkCommandBuffer cmd, const void *data, u32 size) const;
+
 
     // ----------- Construction Methods ------------- //
 
@@ -54,11 +67,26 @@ namespace ren {
       return pipelineLayout;
     }
 
+    // The layout of set `index`, to allocate the pipeline's descriptor sets with.
+    VkDescriptorSetLayout getSetLayout(u32 index) const { return setLayouts.at(index); }
+    u32 getSetCount(void) const { return static_cast<u32>(setLayouts.size()); }
+
    protected:
+    // Build pipelineLayout out of the shaders' reflection: their sets (with
+    // the stages of every shader that uses a binding), and one push constant
+    // range covering every shader's block. `setLayouts[i]`, if given and not
+    // VK_NULL_HANDLE, is used for set i instead. It has to be for a set with
+    // a runtime sized array, like the bindless texture table.
+    void buildLayout(const std::vector<ref<Shader>> &shaders,
+                     const std::vector<VkDescriptorSetLayout> &setLayouts = {});
+
     // Update this in subclasses to set the bind point.
     VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    // The pipeline layout
+    // The pipeline layout, from the LayoutCache.
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    // Zero sized if no shader has push constants.
+    VkPushConstantRange pushConstantRange = {};
     // The main Vulkan pipeline handle.
     VkPipeline pipeline = VK_NULL_HANDLE;
 
@@ -23,9 +23,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 
-// How many frames we want to render in flight at once.
-// currently, anything other than 3 crashes.
-const int MAX_FRAMES_IN_FLIGHT = 3;
+// The most frames the CPU can record ahead of the GPU. How many are actually
+// in flight is picked at startup (see ApplicationConfig::framesInFlight).
+const int MAX_FRAMES_IN_FLIGHT = 4;
 
 using u8 = uint8_t;
 using i8 = int8_t;
@@ -58,6 +58,8 @@ namespace ren {
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
+    // Into the bindless texture table (see BindlessTextures).
+    u32 textureIndex;
   };
 
 
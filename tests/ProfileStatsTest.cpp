@@ -0,0 +1,87 @@
+// Tests for ren::ProfileStats. It doesn't touch Vulkan or SDL, so this runs
+// anywhere the tree configures.
+
+#include <ren/core/Instrumentation.h>
+#include <ren/core/ProfileStats.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+
+static const ren::ScopeStats *findScope(const std::vector<ren::ScopeStats> &scopes,
+                                        const char *name) {
+  for (auto &scope : scopes) {
+    if (strcmp(scope.name, name) == 0) return &scope;
+  }
+  return nullptr;
+}
+
+
+// One scope per frame, N frame marks. Every mark past the first OPEN_FRAMES - 1
+// should close exactly one frame into the history, with exactly one call in it.
+static void testEveryMarkClosesAFrame(void) {
+  constexpr uint32_t MARKS = 20;
+  constexpr uint32_t CLOSED = MARKS - ren::ProfileStats::OPEN_FRAMES + 1;
+  static const char *name = "Frame Scope";
+  static const char *once = "First Frame Scope";
+
+  ren::ProfileStats stats(64);
+  for (uint32_t i = 0; i < MARKS; i++) {
+    ren::TraceEvent event;
+    event.name = name;
+    event.timestamp = i * 1000 + 10;
+    // Frame i takes i + 1 ns, so the max says which frame was closed last.
+    event.duration = i + 1;
+    stats.add(0, event);
+    if (i == 0) {
+      event.name = once;
+      stats.add(0, event);
+    }
+    stats.endFrame((i + 1) * 1000);
+  }
+
+  std::vector<ren::ScopeStats> scopes;
+  stats.snapshot(scopes);
+  auto *scope = findScope(scopes, name);
+  CHECK(scope != nullptr);
+  if (scope == nullptr) return;
+  CHECK(!scope->gpu);
+  CHECK(scope->callsPerFrame == 1.0);
+  CHECK(scope->max == CLOSED);
+  CHECK(scope->mean == (CLOSED + 1) / 2);
+
+  // A scope that only ran in the first frame is spread over every frame in the history.
+  auto *first = findScope(scopes, once);
+  CHECK(first != nullptr);
+  if (first != nullptr) CHECK(first->callsPerFrame == 1.0 / CLOSED);
+
+  // The last frame closed is the one holding the event with duration CLOSED.
+  std::vector<ren::FlameEntry> entries;
+  CHECK(stats.lastFrame(entries) == 1000);
+  CHECK(entries.size() == 1);
+  if (entries.size() == 1) CHECK(entries[0].duration == CLOSED);
+}
+
+
+int main(void) {
+  testEveryMarkClosesAFrame();
+
+  if (failures != 0) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all tests passed\n");
+  return 0;
+}